@@ -0,0 +1,272 @@
+#!/bin/bash
+
+# Simulation benchmark over the example models.
+# Every examples/*.pli model is compiled with plingua and simulated with psim
+# in deterministic and randomized mode, and profiled per phase in another run.
+# A measurement lasts at least BENCH_MIN_SECONDS of simulation: the steps are
+# raised until a run is long enough, and the runs of the models that halt
+# before are repeated and added up. Every model is measured BENCH_REPEATS times
+# and the medians of steps/s, applications/s and peak memory are kept. Models
+# still too short to time after BENCH_MAX_RUNS runs are marked "timed": false,
+# only their peak memory is compared.
+# Results are written as JSON, one entry per line, and compared with a baseline
+# written in the same format by "make bench-baseline"; the steps and runs of
+# every model are taken from the baseline so both measure the same work. A
+# model of the baseline which fails to compile or to simulate is a regression.
+# bench/baseline.json is the reference baseline of the repository, measured with
+# the default settings on a single core Intel Xeon virtual machine with 5 GB of
+# memory, Linux 6.18 and g++ 12.2 (-O3). Other machines should store their own
+# baseline with "make bench-baseline" before comparing.
+# The counter model is also simulated with and without macro-steps (psim -m),
+# which must fire and reach the same configuration, and every model is compiled
+# again as rule families (plingua --families), which must simulate as the plain
+# file; the families model has negative indexes and uneven sets of points.
+#
+# Models which are not benchmarked (see UNSUPPORTED):
+#   *_model.pli                  model definitions included by the other files
+#   Avian_Scavengers,            environments and probabilities (::) in rules
+#   bearded_vulture_2_0          which plingua rejects
+#   bv_model_bwmc12, tritrophic, probabilistic skeleton rules, psim aborts with
+#   zebra_mussel                 "Rule not supported"
+#
+# usage: bench/bench.sh results.json [baseline.json]
+#
+# environment:
+#   BENCH_STEPS        initial steps to simulate (100)
+#   BENCH_MIN_SECONDS  minimum simulation time of a measurement (0.5)
+#   BENCH_MAX_STEPS    maximum steps to simulate (1000000)
+#   BENCH_MAX_RUNS     maximum runs added up in a measurement (500)
+#   BENCH_REPEATS      measurements of every model, the median is kept (5)
+#   BENCH_SEED         seed for the randomized runs (1)
+#   BENCH_TOLERANCE    allowed change against the baseline in percent (20): drop of
+#                      steps/s and applications/s, growth of the peak memory
+
+BDIR=${BDIR:-bin}
+STEPS=${BENCH_STEPS:-100}
+MIN_SECONDS=${BENCH_MIN_SECONDS:-0.5}
+MAX_STEPS=${BENCH_MAX_STEPS:-1000000}
+MAX_RUNS=${BENCH_MAX_RUNS:-500}
+REPEATS=${BENCH_REPEATS:-5}
+SEED=${BENCH_SEED:-1}
+TOLERANCE=${BENCH_TOLERANCE:-20}
+OUTPUT=${1:-bench/results.json}
+BASELINE=$2
+UNSUPPORTED="Avian_Scavengers bearded_vulture_2_0 bv_model_bwmc12 tritrophic zebra_mussel"
+
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+now() {
+	date +%s.%N
+}
+
+# value of a numeric field in a JSON line, the last one if it is repeated
+field() {
+	echo "$1" | sed -n "s/.*\"$2\": \([-0-9.e+]*\).*/\1/p"
+}
+
+# simulate a model $runs times for $steps steps and print the totals of the
+# runs: seconds, simulated steps, applications and the peak memory
+measure() {
+	local name=$1 flags=$2 steps=$3 runs=$4
+	rm -f "$TMP/batch"
+	for ((run = 0; run < runs; run++)); do
+		rm -f "$TMP/stats.json"
+		"$BDIR/psim" "$TMP/$name.bin" -s "$steps" -v 0 $flags -S "$TMP/stats.json" > /dev/null 2>&1
+		if [ ! -f "$TMP/stats.json" ]; then
+			return 1
+		fi
+		stats=$(cat "$TMP/stats.json")
+		echo "$(field "$stats" seconds) $(field "$stats" steps) $(field "$stats" applications) $(field "$stats" peak_rss_kb)" >> "$TMP/batch"
+	done
+	awk '{s += $1; n += $2; a += $3; if ($4 > p) p = $4} END {print s, n, a, p}' "$TMP/batch"
+}
+
+# median of the numbers read from the standard input
+median() {
+	sort -g | awk '{v[NR] = $1} END {print v[int((NR + 1) / 2)]}'
+}
+
+# every model which is not in UNSUPPORTED has to compile and simulate
+fail() {
+	echo "FAILED $1"
+	status=1
+}
+
+status=0
+echo "[" > "$TMP/results.json"
+first=1
+for model in examples/*.pli; do
+	name=$(basename "$model" .pli)
+	case "$name" in
+		*_model) continue ;;
+	esac
+	if [[ " $UNSUPPORTED " == *" $name "* ]]; then
+		echo "$name: not supported, see bench/bench.sh"
+		continue
+	fi
+	start=$(now)
+	if ! "$BDIR/plingua" "$model" -o "$TMP/$name.bin" -f bin > "$TMP/$name.log" 2>&1 || [ ! -f "$TMP/$name.bin" ]; then
+		rm -f "$TMP/$name.bin"
+		fail "$name: compilation failed"
+		continue
+	fi
+	compile=$(awk -v a="$start" -v b="$(now)" 'BEGIN {print b - a}')
+	for mode in deterministic randomized; do
+		flags=""
+		if [ "$mode" = "randomized" ]; then
+			flags="-r --seed $SEED"
+		fi
+		key="\"name\": \"$name\", \"mode\": \"$mode\""
+		reference=""
+		if [ -n "$BASELINE" ] && [ -f "$BASELINE" ]; then
+			reference=$(grep -F "$key" "$BASELINE")
+		fi
+		if [ -n "$reference" ]; then
+			steps=$(field "$reference" steps)
+			runs=$(field "$reference" runs)
+		else
+			# raise the steps until a run lasts long enough, or repeat the runs of a model which halts
+			steps=$STEPS
+			runs=1
+			while totals=$(measure "$name" "$flags" "$steps" 1); do
+				read seconds simulated applications peak <<< "$totals"
+				if awk -v s="$seconds" -v m="$MIN_SECONDS" 'BEGIN {exit !(s >= m)}'; then
+					break
+				fi
+				if [ "$simulated" -lt "$steps" ] || [ "$steps" -ge "$MAX_STEPS" ]; then
+					# a model which cannot be timed within the maximum of runs is only run once
+					runs=$(awk -v s="$seconds" -v m="$MIN_SECONDS" -v r="$MAX_RUNS" 'BEGIN {n = s > 0 ? int(m / s * 1.2) + 1 : r + 1; print n <= r ? n : 1}')
+					break
+				fi
+				steps=$(awk -v s="$seconds" -v m="$MIN_SECONDS" -v n="$steps" -v x="$MAX_STEPS" 'BEGIN {f = s > 0 ? m / s * 1.2 : 10; f = f < 2 ? 2 : f > 10 ? 10 : f; n = int(n * f); print n < x ? n : x}')
+			done
+		fi
+		rm -f "$TMP/measures"
+		for ((repeat = 0; repeat < REPEATS; repeat++)); do
+			if ! totals=$(measure "$name" "$flags" "$steps" "$runs"); then
+				rm -f "$TMP/measures"
+				break
+			fi
+			echo "$totals" | awk '{print $1, $2, ($1 > 0 ? $2 / $1 : 0), ($1 > 0 ? $3 / $1 : 0), $4}' >> "$TMP/measures"
+		done
+		if [ ! -f "$TMP/measures" ]; then
+			fail "$name ($mode): simulation failed"
+			continue
+		fi
+		seconds=$(cut -d" " -f1 "$TMP/measures" | median)
+		simulated=$(cut -d" " -f2 "$TMP/measures" | median)
+		rate=$(cut -d" " -f3 "$TMP/measures" | median)
+		applications=$(cut -d" " -f4 "$TMP/measures" | median)
+		peak=$(cut -d" " -f5 "$TMP/measures" | median)
+		timed=true
+		if awk -v s="$seconds" -v m="$MIN_SECONDS" 'BEGIN {exit !(s < m)}'; then
+			timed=false
+		fi
+		# the timers slow the simulation down, so the profile comes from another run
+		echo "null" > "$TMP/profile.json"
+		"$BDIR/psim" "$TMP/$name.bin" -s "$steps" -v 0 $flags -P "$TMP/profile.json" > /dev/null 2>&1
+		if [ $first -eq 0 ]; then
+			echo "," >> "$TMP/results.json"
+		fi
+		first=0
+		printf '{"name": "%s", "mode": "%s", "compile_seconds": %s, "profile": %s, "steps": %s, "runs": %s, "repeats": %s, "timed": %s, "simulated_steps": %s, "seconds": %s, "steps_per_second": %s, "applications_per_second": %s, "peak_rss_kb": %s}' \
+			"$name" "$mode" "$compile" "$(cat "$TMP/profile.json")" "$steps" "$runs" "$REPEATS" "$timed" "$simulated" "$seconds" "$rate" "$applications" "$peak" >> "$TMP/results.json"
+		note=""
+		if [ $timed = false ]; then
+			note=", too short to time"
+		fi
+		echo "$name ($mode): $steps steps x $runs runs, $simulated steps in ${seconds}s, $rate steps/s, $applications applications/s, $peak KB$note"
+	done
+done
+echo "" >> "$TMP/results.json"
+echo "]" >> "$TMP/results.json"
+cp "$TMP/results.json" "$OUTPUT"
+echo "results written to $OUTPUT"
+
+# last configuration printed by psim
+last_configuration() {
+	awk '/^CONFIGURATION:/ {text = ""} {text = text $0 "\n"} END {printf "%s", text}' "$1"
+}
+
+if [ -f "$TMP/counter.bin" ]; then
+	"$BDIR/psim" "$TMP/counter.bin" -s "$STEPS" -v 5 > "$TMP/single.log" 2>&1
+	"$BDIR/psim" "$TMP/counter.bin" -s "$STEPS" -v 5 -m > "$TMP/macro.log" 2>&1
+	macro=$(grep -c "^MACRO-STEP" "$TMP/macro.log")
+	if [ "$macro" -eq 0 ]; then
+		echo "MACRO-STEP counter: no macro-steps applied"
+		status=1
+	elif [ "$(last_configuration "$TMP/single.log")" != "$(last_configuration "$TMP/macro.log")" ]; then
+		echo "MACRO-STEP counter: the configurations differ from single steps"
+		status=1
+	else
+		echo "counter: $macro macro-steps"
+	fi
+fi
+
+families=0
+for model in examples/*.pli; do
+	name=$(basename "$model" .pli)
+	if [ ! -f "$TMP/$name.bin" ]; then
+		continue
+	fi
+	if ! "$BDIR/plingua" "$model" --families -o "$TMP/$name.families.bin" -f bin > /dev/null 2>&1 || [ ! -f "$TMP/$name.families.bin" ]; then
+		echo "FAMILIES $name: compilation failed"
+		status=1
+		continue
+	fi
+	"$BDIR/psim" "$TMP/$name.bin" -s "$STEPS" -v 5 > "$TMP/plain.log" 2>&1
+	plain=$?
+	"$BDIR/psim" "$TMP/$name.families.bin" -s "$STEPS" -v 5 > "$TMP/families.log" 2>&1
+	if [ $? -ne $plain ] || [ "$(last_configuration "$TMP/plain.log")" != "$(last_configuration "$TMP/families.log")" ]; then
+		echo "FAMILIES $name: the configurations differ from the plain file"
+		status=1
+	else
+		families=$((families + 1))
+	fi
+done
+echo "families: $families models simulate as their plain files"
+
+if [ -z "$BASELINE" ] || [ ! -f "$BASELINE" ]; then
+	exit $status
+fi
+
+while read -r reference; do
+	case "$reference" in
+		*'"name"'*) ;;
+		*) continue ;;
+	esac
+	key=$(echo "$reference" | sed -n 's/.*\("name": "[^"]*", "mode": "[^"]*"\).*/\1/p')
+	line=$(grep -F "$key" "$OUTPUT")
+	if [ -z "$line" ]; then
+		echo "REGRESSION $key: no result"
+		status=1
+		continue
+	fi
+	metrics=peak_rss_kb
+	if [[ "$line" == *'"timed": true'* && "$reference" == *'"timed": true'* ]]; then
+		metrics="steps_per_second applications_per_second peak_rss_kb"
+	fi
+	for metric in $metrics; do
+		current=$(field "$line" $metric)
+		expected=$(field "$reference" $metric)
+		if [ -z "$current" ] || [ -z "$expected" ]; then
+			continue
+		fi
+		# rates regress when they fall, the peak memory when it grows
+		if [ $metric = peak_rss_kb ]; then
+			regression='c > e * (100 + t) / 100'
+		else
+			regression='c < e * (100 - t) / 100'
+		fi
+		if awk -v c="$current" -v e="$expected" -v t="$TOLERANCE" "BEGIN {exit !($regression)}"; then
+			echo "REGRESSION $key: $metric $current, baseline $expected"
+			status=1
+		fi
+	done
+done < "$BASELINE"
+
+if [ $status -eq 0 ]; then
+	echo "no regressions against $BASELINE (tolerance $TOLERANCE%)"
+fi
+exit $status
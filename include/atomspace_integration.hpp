@@ -9,6 +9,7 @@
 #include <functional>
 #include <cmath>
 #include "relevance_realization.hpp"
+#include "memory_accounting.hpp"
 
 namespace plingua { namespace atomspace {
 
@@ -118,6 +119,19 @@ public:
         auto it = atoms.find(id);
         return it != atoms.end() ? it->second : nullptr;
     }
+    
+    // Approximate memory used by the atoms
+    void accountMemory(plingua::MemoryReport& report) const {
+        std::size_t bytes = 0;
+        std::size_t links = 0;
+        for (auto it = atoms.begin(); it != atoms.end(); ++it) {
+            bytes += plingua::memory::TREE_NODE_BYTES + sizeof(*it) + sizeof(Atom);
+            bytes += plingua::memory::bytes(it->second->name) + it->second->outgoing.capacity() * sizeof(unsigned);
+            links += it->second->outgoing.size();
+        }
+        report.add("atomspace/atoms", atoms.size(), bytes);
+        report.add("atomspace/outgoing", links, 0);
+    }
 };
 
 // Integration bridge between RR hypergraphs and AtomSpace
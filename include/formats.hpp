@@ -84,6 +84,10 @@ bool codifyCplusplus(const File& file, const std::string& path);
 // DO NOT MODIFY THE REST OF THIS FILE
 ////////////////////////////////////////
 bool codify(Format format, const File& file, const std::string& path);
+// formats written by the archives of the serialization (json, xml, bin and bin2), which
+// can be written with the rules of a spool instead of the rules of the file
+bool isArchive(Format format);
+bool codifyStreamed(Format format, const File& file, const parser::RuleSpool& rules, const std::string& path);
 /////////////////////////////////////////////////////////
 // Utility functions, you can use them for printing messages
 void printFatalMessage(const std::string& message) ;
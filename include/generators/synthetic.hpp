@@ -0,0 +1,143 @@
+#ifndef _SYNTHETIC_HPP_
+#define _SYNTHETIC_HPP_
+
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <serialization.hpp>
+#include <random.hpp>
+#include <parser/constants.hpp>
+
+namespace plingua { namespace generators {
+
+// Parameters of a synthetic P system with active membranes
+struct SyntheticParameters
+{
+	SyntheticParameters()
+	: membranes(100), depth(3), labels(10), alphabet(50), rules(10), lhs(2),
+	  multiplicity(10), division(0.0), dissolution(0.0), competition(0.0), seed(1) {}
+
+	unsigned membranes;   // membranes in the initial structure, skin included
+	unsigned depth;       // maximum nesting depth, the skin has depth 0
+	unsigned labels;      // labels of the non-skin membranes
+	unsigned alphabet;    // number of objects
+	unsigned rules;       // rules per label
+	unsigned lhs;         // objects in the left-hand side of every rule
+	unsigned multiplicity; // copies of every object of the left-hand sides in the initial multisets
+	double division;      // fraction of the rules of elementary labels that divide the membrane
+	double dissolution;   // fraction of the rules of non-skin labels that dissolve the membrane
+	double competition;   // probability of an object of a left-hand side being shared by all the rules of its label
+	unsigned seed;
+};
+
+// Build a P system for the parameters, the same parameters always give the same P system.
+// The rules of a label form a cycle, every rule produces the left-hand side of the next one,
+// so membranes never stop evolving and the size of a configuration only changes by
+// division and dissolution.
+void generateSynthetic(const SyntheticParameters& parameters, File& file);
+
+namespace synthetic {
+
+inline std::string getObject(unsigned i) {return "o" + std::to_string(i);}
+
+inline Label getLabel(unsigned i) {return Label(1, LabelString(i == 0 ? "skin" : std::to_string(i)));}
+
+// left-hand side of a rule, shared objects come from the first lhs objects of the alphabet
+inline Multiset getLeftHandSide(const SyntheticParameters& parameters, RandomNumberGenerator& random)
+{
+	Multiset multiset;
+	for (unsigned i = 0; i < parameters.lhs; i++) {
+		unsigned object = random() < parameters.competition ? random(parameters.lhs) : random(parameters.alphabet);
+		multiset[getObject(object)] += 1;
+	}
+	return multiset;
+}
+
+}
+
+inline
+void generateSynthetic(const SyntheticParameters& parameters, File& file)
+{
+	if (parameters.membranes == 0 || parameters.alphabet == 0 || parameters.lhs == 0) {
+		throw std::invalid_argument("the number of membranes, the alphabet size and the left-hand side width must be positive");
+	}
+	if (parameters.membranes > 1 && (parameters.labels == 0 || parameters.depth == 0)) {
+		throw std::invalid_argument("a P system with more than one membrane needs at least one label and depth 1");
+	}
+	if (parameters.lhs > parameters.alphabet) {
+		throw std::invalid_argument("the left-hand side width cannot be greater than the alphabet size");
+	}
+	RandomNumberGenerator random(parameters.seed);
+
+	file.header = FILE_HEADER;
+	file.version = FILE_VERSION;
+	file.psystem = Psystem();
+	file.psystem.model = "membrane_division";
+
+	// membrane structure: a chain reaching the depth, then random parents above the depth
+	std::vector<unsigned> depths(1, 0);
+	std::vector<unsigned> parents(1, 0); // membranes which can have children
+	std::vector<bool> elementary(parameters.labels + 1, true);
+	file.psystem.structure.label = synthetic::getLabel(0);
+	std::vector<std::vector<unsigned>> children(parameters.membranes);
+	std::vector<unsigned> labels(parameters.membranes, 0);
+	for (unsigned i = 1; i < parameters.membranes; i++) {
+		unsigned parent = i <= parameters.depth ? i - 1 : parents[random(parents.size())];
+		depths.push_back(depths[parent] + 1);
+		if (depths[i] < parameters.depth) {
+			parents.push_back(i);
+		}
+		children[parent].push_back(i);
+		labels[i] = 1 + random(parameters.labels);
+		elementary[labels[parent]] = false;
+	}
+	// children are added in depth-first order, the vector of a membrane is not resized after its children are visited
+	std::vector<std::pair<Membrane*, unsigned>> stack(1, {&file.psystem.structure, 0});
+	while (!stack.empty()) {
+		Membrane* membrane = stack.back().first;
+		unsigned index = stack.back().second;
+		stack.pop_back();
+		membrane->data.resize(children[index].size());
+		for (unsigned i = 0; i < children[index].size(); i++) {
+			membrane->data[i].label = synthetic::getLabel(labels[children[index][i]]);
+			stack.push_back({&membrane->data[i], children[index][i]});
+		}
+	}
+
+	// the initial multiset of a label has the objects of its left-hand sides, so all its rules can be applied
+	for (unsigned label = 0; label <= parameters.labels; label++) {
+		Multiset& initial = file.psystem.multisets[synthetic::getLabel(label)];
+		std::vector<Rule> rules(parameters.rules);
+		for (Rule& rule : rules) {
+			rule.lhr.membrane.label = synthetic::getLabel(label);
+			rule.lhr.membrane.multiset = synthetic::getLeftHandSide(parameters, random);
+			for (auto it = rule.lhr.membrane.multiset.begin(); it != rule.lhr.membrane.multiset.end(); ++it) {
+				initial[it->first] = parameters.multiplicity;
+			}
+		}
+		for (unsigned r = 0; r < rules.size(); r++) {
+			Rule& rule = rules[r];
+			const Multiset& next = rules[(r + 1) % rules.size()].lhr.membrane.multiset;
+			double kind = random();
+			if (label > 0 && elementary[label] && kind < parameters.division) {
+				rule.rhr.data.resize(2);
+				for (OMembrane& membrane : rule.rhr.data) {
+					membrane.label = rule.lhr.membrane.label;
+					membrane.multiset = next;
+				}
+			} else if (label > 0 && kind >= 1.0 - parameters.dissolution) {
+				// the objects of a dissolved membrane go to its parent
+				rule.rhr.multiset = next;
+			} else {
+				rule.rhr.data.resize(1);
+				rule.rhr.data[0].label = rule.lhr.membrane.label;
+				rule.rhr.data[0].multiset = next;
+			}
+			file.psystem.rules.insert(rule);
+		}
+	}
+}
+
+}}
+
+#endif
@@ -0,0 +1,181 @@
+#ifndef _MEMORY_ACCOUNTING_HPP_
+#define _MEMORY_ACCOUNTING_HPP_
+
+#include <vector>
+#include <map>
+#include <set>
+#include <string>
+#include <ostream>
+#include <serialization.hpp>
+
+namespace plingua {
+
+// Approximate memory used by the structures of a program, by name.
+// Sizes are estimated from the element counts and capacities of the
+// containers, allocator overheads are not measured.
+class MemoryReport
+{
+public:
+	struct Entry {
+		std::string name;
+		std::size_t elements;
+		std::size_t bytes;
+	};
+
+	// add elements and bytes to an entry, entries keep their insertion order
+	void add(const std::string& name, std::size_t elements, std::size_t bytes);
+	const std::vector<Entry>& getEntries() const {return entries;}
+	std::size_t getTotalBytes() const;
+	void clear() {entries.clear(); indexes.clear();}
+
+private:
+	std::vector<Entry> entries;
+	std::map<std::string, unsigned> indexes;
+};
+
+namespace memory {
+
+// bytes of a node of std::map or std::set, besides the value
+const std::size_t TREE_NODE_BYTES = 32;
+
+// bytes of a node of std::unordered_map, besides the value, and its bucket
+const std::size_t HASH_NODE_BYTES = 24;
+
+// heap bytes of a string (short strings live inside the object)
+inline std::size_t bytes(const std::string& str) {return str.capacity() > 15 ? str.capacity() + 1 : 0;}
+
+// the characters of a String are in the pool of interned strings
+inline std::size_t bytes(const String&) {return sizeof(String);}
+
+inline std::size_t bytes(const Label& label) {return label.capacity() * sizeof(LabelString);}
+
+inline std::size_t bytes(const Multiset& multiset) {return multiset.size() * (TREE_NODE_BYTES + sizeof(Multiset::value_type));}
+
+inline std::size_t bytes(const Semantics& semantics)
+{
+	std::size_t total = semantics.patterns.size() * TREE_NODE_BYTES + semantics.children.capacity() * sizeof(Semantics);
+	for (const String& pattern : semantics.patterns) {
+		total += bytes(pattern);
+	}
+	for (const Semantics& child : semantics.children) {
+		total += bytes(child);
+	}
+	return total;
+}
+
+inline std::size_t bytes(const IMembrane& membrane) {return bytes(membrane.label) + bytes(membrane.multiset);}
+
+inline std::size_t bytes(const OMembrane& membrane)
+{
+	std::size_t total = bytes((const IMembrane&)membrane) + membrane.data.capacity() * sizeof(IMembrane);
+	for (const IMembrane& child : membrane.data) {
+		total += bytes(child);
+	}
+	return total;
+}
+
+inline std::size_t bytes(const Rule& rule)
+{
+	std::size_t total = bytes(rule.lhr.multiset) + bytes(rule.lhr.membrane) + bytes(rule.rhr.multiset);
+	total += rule.rhr.data.capacity() * sizeof(OMembrane);
+	for (const OMembrane& membrane : rule.rhr.data) {
+		total += bytes(membrane);
+	}
+	total += rule.features.size() * (TREE_NODE_BYTES + sizeof(Features::value_type));
+	return total;
+}
+
+// membranes of a configuration by label, multisets and semantics reported apart
+inline void account(const Configuration& configuration, MemoryReport& report)
+{
+	report.add("configuration/environment", configuration.environment.size(), bytes(configuration.environment));
+	report.add("configuration/membranes", configuration.membranes.size(), configuration.membranes.capacity() * sizeof(CMembrane));
+	for (const CMembrane& m : configuration.membranes) {
+		if (m.parent == -2) {
+			continue;
+		}
+		std::string label;
+		for (unsigned i = 0; i < m.label.size(); i++) {
+			label += (i > 0 ? "," : "") + m.label[i].str();
+		}
+		report.add("configuration/membranes[" + label + "]", 1, sizeof(CMembrane) + bytes(m.label) + m.children.capacity() * sizeof(int));
+		report.add("configuration/multisets[" + label + "]", m.multiset.size(), bytes(m.multiset));
+		report.add("configuration/semantics[" + label + "]", 1, bytes(m.semantics));
+	}
+}
+
+inline void account(const std::string& name, const std::vector<std::vector<Rule>>& ruleSets, MemoryReport& report)
+{
+	report.add(name, 0, ruleSets.capacity() * sizeof(std::vector<Rule>));
+	for (const std::vector<Rule>& rules : ruleSets) {
+		std::size_t total = rules.capacity() * sizeof(Rule);
+		for (const Rule& rule : rules) {
+			total += bytes(rule);
+		}
+		report.add(name, rules.size(), total);
+	}
+}
+
+// every rule of a RuleSet has its hash, a node of the hash index and its position in the order
+const std::size_t RULE_SET_BYTES = 2 * sizeof(std::size_t) + HASH_NODE_BYTES + sizeof(unsigned);
+
+inline void account(const std::string& name, const RuleSet& rules, MemoryReport& report)
+{
+	std::size_t total = rules.size() * (RULE_SET_BYTES + sizeof(Rule));
+	for (const Rule& rule : rules) {
+		total += bytes(rule);
+	}
+	report.add(name, rules.size(), total);
+}
+
+// tables of the Alphabet singleton, every interned string is kept in a hash table and in an array,
+// and the pool of interned strings
+inline void accountAlphabet(MemoryReport& report)
+{
+	const std::size_t entry = HASH_NODE_BYTES + sizeof(std::pair<const std::string* const, UId>) + sizeof(const std::string*);
+	report.add("alphabet/objects", ALPHABET.getObjectAlphabetSize(), ALPHABET.getObjectAlphabetSize() * entry);
+	report.add("alphabet/labels", ALPHABET.getLabelAlphabetSize(), ALPHABET.getLabelAlphabetSize() * entry);
+	report.add("alphabet/features", ALPHABET.getFeatureAlphabetSize(), ALPHABET.getFeatureAlphabetSize() * entry);
+	report.add("alphabet/strings", ALPHABET.getStringsAlphabetSize(), ALPHABET.getStringsAlphabetSize() * entry);
+	report.add("strings", STRING_POOL.size(), STRING_POOL.size() * (HASH_NODE_BYTES + sizeof(std::string)) + STRING_POOL.bytes());
+}
+
+}
+
+
+inline
+void MemoryReport::add(const std::string& name, std::size_t elements, std::size_t bytes)
+{
+	auto it = indexes.find(name);
+	if (it == indexes.end()) {
+		indexes[name] = entries.size();
+		entries.push_back({name, elements, bytes});
+	} else {
+		entries[it->second].elements += elements;
+		entries[it->second].bytes += bytes;
+	}
+}
+
+inline
+std::size_t MemoryReport::getTotalBytes() const
+{
+	std::size_t total = 0;
+	for (const Entry& entry : entries) {
+		total += entry.bytes;
+	}
+	return total;
+}
+
+}
+
+inline
+std::ostream& operator <<(std::ostream& os, const plingua::MemoryReport& arg)
+{
+	os << "MEMORY: " << arg.getTotalBytes() << " bytes" << std::endl;
+	for (const plingua::MemoryReport::Entry& entry : arg.getEntries()) {
+		os << "\t" << entry.name << ": " << entry.elements << " elements, " << entry.bytes << " bytes" << std::endl;
+	}
+	return os;
+}
+
+#endif
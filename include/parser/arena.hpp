@@ -0,0 +1,85 @@
+#ifndef _ARENA_HPP_
+#define _ARENA_HPP_
+
+#include <vector>
+#include <cstring>
+#include <new>
+
+namespace plingua{ namespace parser
+{
+
+// Memory of the syntax trees of a parse. Nodes, their children and string
+// literals are allocated in blocks and released at once by clear(), the
+// objects with destructors are destroyed in a single pass, without recursion.
+class Arena
+{
+public:
+	static const std::size_t BLOCK_SIZE = 64*1024;
+	static const std::size_t ALIGNMENT = alignof(std::max_align_t);
+
+	Arena() : next(NULL), left(0) {}
+	~Arena() {clear();}
+	Arena(const Arena&) = delete;
+	void operator=(const Arena&) = delete;
+
+	void* allocate(std::size_t size)
+	{
+		size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+		if (size > left) {
+			// the rest of the current block is lost
+			std::size_t block = size > BLOCK_SIZE ? size : BLOCK_SIZE;
+			blocks.push_back(static_cast<char*>(::operator new(block)));
+			next = blocks.back();
+			left = block;
+		}
+		void* pointer = next;
+		next += size;
+		left -= size;
+		return pointer;
+	}
+
+	char* copy(const char* str)
+	{
+		std::size_t size = strlen(str) + 1;
+		char* pointer = static_cast<char*>(allocate(size));
+		memcpy(pointer, str, size);
+		return pointer;
+	}
+
+	// destroy object, allocated in the arena, when the arena is cleared
+	template<class T> void addDestructor(T* object)
+	{
+		destructors.push_back({object, [](void* pointer) {static_cast<T*>(pointer)->~T();}});
+	}
+
+	void clear()
+	{
+		for (auto it = destructors.rbegin(); it != destructors.rend(); ++it) {
+			it->destroy(it->object);
+		}
+		destructors.clear();
+		for (char* block : blocks) {
+			::operator delete(block);
+		}
+		blocks.clear();
+		next = NULL;
+		left = 0;
+	}
+
+	std::size_t getBlocks() const {return blocks.size();}
+
+private:
+	struct Destructor {
+		void* object;
+		void (*destroy)(void*);
+	};
+
+	std::vector<char*> blocks;
+	std::vector<Destructor> destructors;
+	char* next;
+	std::size_t left;
+};
+
+}}
+
+#endif
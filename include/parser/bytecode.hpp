@@ -0,0 +1,90 @@
+#ifndef _BYTECODE_HPP_
+#define _BYTECODE_HPP_
+
+#include <vector>
+#include <string>
+#include <parser/node_value.hpp>
+#include <parser/syntax_tree.hpp>
+#include <parser/scope.hpp>
+
+namespace plingua{ namespace parser
+{
+
+enum Opcode : unsigned char
+{
+	OP_CONSTANT,      // push constants[operand]
+	OP_SLOT,          // push slots[operand]
+	OP_VARIABLE,      // push the variable names[operand] without indexes
+	OP_INDEXED,       // pop the indexes of names[operand] and push the variable
+	OP_CAST_LONG,
+	OP_CAST_DOUBLE,
+	OP_CAST_STRING,
+	OP_MINUS,
+	OP_NOT,
+	OP_BITWISE_NOT,
+	OP_MUL,
+	OP_DIV,
+	OP_MOD,
+	OP_ADD,
+	OP_SUB,
+	OP_BITWISE_LEFT,
+	OP_BITWISE_RIGHT,
+	OP_LESS_THAN,
+	OP_LESS_OR_EQUAL_THAN,
+	OP_GREATER_THAN,
+	OP_GREATER_OR_EQUAL_THAN,
+	OP_EQUAL,
+	OP_DIFF,
+	OP_BITWISE_AND,
+	OP_BITWISE_OR,
+	OP_BITWISE_XOR
+};
+
+struct Instruction
+{
+	Opcode opcode;
+	unsigned operand;
+};
+
+// Side-effect-free expression compiled to a stack machine. The variables of
+// the ranges being unrolled live in numbered slots, other variables are read
+// from Memory by name and constant subexpressions are folded.
+class Bytecode
+{
+public:
+	static const unsigned MAX_DEPTH = 16;
+
+	// return NULL if the expression calls modules, assigns variables or is too deep,
+	// slots are the names of the variables kept in slots and index is the position
+	// of the expression in its sentence
+	static Bytecode* compile(const Node& node, const std::vector<std::string>& slots, unsigned index);
+
+	// return false if any step gives an invalid value, the tree walker should
+	// compute the expression again to report the errors
+	bool evaluate(const Memory& memory, const NodeValue* slots, NodeValue& result) const;
+
+	// slot of an expression made of a single slot variable, -1 otherwise
+	int getSlot() const {return code.size()==1 && code[0].opcode==OP_SLOT ? (int)code[0].operand : -1;}
+
+	unsigned getIndex() const {return index;}
+
+private:
+	struct Name {
+		std::string id;
+		std::vector<unsigned> indexes; // number of indexes in every {}
+	};
+
+	Bytecode(unsigned index) : index(index) {}
+	bool compileNode(const Node& node, const std::vector<std::string>& slots, unsigned height);
+	bool compileVariable(const Node& node, const std::vector<std::string>& slots, unsigned height);
+	void fold(unsigned operands);
+
+	std::vector<Instruction> code;
+	std::vector<NodeValue> constants;
+	std::vector<Name> names;
+	unsigned index;
+};
+
+}}
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef _COMPILER_HPP_
+#define _COMPILER_HPP_
+
+#include <vector>
+#include <string>
+#include <serialization.hpp>
+
+namespace plingua{ namespace parser
+{
+
+// options of plingua for compiling in the process
+struct CompileOptions
+{
+	CompileOptions() : verbosityLevel(2), threads(0), pruning(false), usingColors(false) {}
+	std::vector<std::string> includePaths;
+	int verbosityLevel;
+	unsigned threads;     // threads unrolling the ranges, 0 for one per core
+	bool pruning;
+	bool usingColors;
+};
+
+// Compile P-Lingua files to a File in memory, as plingua does without writing the output.
+// Messages are printed to the standard output. The parser is shared by the process, so
+// compilations from several threads are run one after another.
+bool compile(const std::vector<std::string>& input, File& file, const CompileOptions& options = CompileOptions());
+
+}}
+
+#endif
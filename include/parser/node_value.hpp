@@ -54,6 +54,9 @@ public:
 	NodeValue(NodeValueType type, char* value) : value(parseString(value)), flags(NO_ERROR | type) {}
 	NodeValue(char* value, bool cte) : value(parseString(value)), flags(NO_ERROR | CSTR) {setCte(cte);}
 	
+	// constant string which is not owned by the value, its copies share it
+	static NodeValue view(char* value);
+	
 	~NodeValue();
 	
 	long getLong() const {return value.longValue;}
@@ -64,6 +67,7 @@ public:
 	NodeValueType getType() const {return (NodeValueType)(flags & TYPE_MASK);}
 	
 	bool isConstant() const {return (flags & CTE_MASK) != 0x00;}
+	bool isView() const {return (flags & VIEW_MASK) != 0x00;}
 	bool isLong() const {return  getType() == LONG || getType() == CLONG;}
 	bool isDouble() const {return getType() == DOUBLE || getType() == CDOUBLE;}
 	bool isString() const {return getType() == STR  || getType() == CSTR;}
@@ -113,6 +117,7 @@ private:
 	static const unsigned int CTE_MASK   =  0x08;
 	static const unsigned int TYPE_MASK  =  0x0F;
 	static const unsigned int ERROR_MASK =  0xF0;
+	static const unsigned int VIEW_MASK  = 0x100;
 
 	static char* parseString(char* str);
 	static char* reverse(char* str);
@@ -5,12 +5,20 @@
 #include <string>
 #include <map>
 #include <set>
+#include <tuple>
+#include <unordered_map>
+#include <mutex>
 #include <cstdio>
 #include <boost/filesystem.hpp> 
 #include <serialization.hpp>
 #include <parser/node_value.hpp>
 #include <parser/scope.hpp>
+#include <parser/arena.hpp>
+#include <parser/rule_spool.hpp>
 #include <parser/syntax_tree.hpp>
+#include <parser/bytecode.hpp>
+#include <parser/worker_pool.hpp>
+#include <parser/compiler.hpp>
 
 
 
@@ -66,6 +74,9 @@ public:
 	const std::vector<boost::filesystem::path>& getFiles() const {return files;}
 	
 	int parse(int argc, char* argv[]);
+	// same as parse for the input files and options, without writing the output,
+	// the P system is moved to output
+	bool compile(const std::vector<std::string>& input, const CompileOptions& options, File& output);
 	int getVerbosityLevel() const {return verbosityLevel;}
 	void update();
 	void error(const char* s, const YYLTYPE& location, ErrorLevel level = LEVEL_ERROR);
@@ -75,10 +86,37 @@ public:
 	void addNode(Node* node);
 	
 	const Node& getRoot() const {return root;}
+	Arena& getArena() {return arena;}
 	
 private:	
+	struct CompiledSentence {
+		int slots;            // -1 if the sentence is walked
+		unsigned expressions;
+	};
+	
+	// state of a compiled sentence while its ranges are expanded, every thread has its own
+	struct Unrolling {
+		Unrolling(Node& ranges, const CompiledSentence& sentence)
+		: ranges(&ranges), slots(sentence.slots,UNKNOWN_VALUE), assignedSlots(sentence.slots,false), worker(false), failed(false) {}
+		Node* ranges;
+		std::vector<NodeValue> slots;       // values of the range variables
+		std::vector<bool> assignedSlots;
+		// workers share the syntax tree, they keep the values of the expressions and
+		// the results here, and any error makes the sentence be unrolled again sequentially
+		bool worker;
+		bool failed;
+		std::vector<NodeValue> values;
+		std::vector<Rule> rules;
+		std::vector<std::tuple<Label,Multiset,int>> multisets;
+	};
+	
 	Parser();
+	// clear the state of a previous compilation
+	void reset();
+	// read the command line of plingua
 	void init(int argc, char* argv[]);
+	// set the options shared by the command line and compile(), and add the input files
+	void setup(const std::vector<std::string>& input, const CompileOptions& options);
 	void printAbout() const;
 	void addFile(const char* file, bool ignoreWarning);
 	void addFile(const boost::filesystem::path& p, bool ignoreWarning);
@@ -96,11 +134,20 @@ private:
 	bool unrollSentence(Node& sentence);
 	bool unrollSentenceB(Node& sentence);
 	bool unrollSentenceR(Node& sentence, Node& ranges, int index);
+	bool unrollSentenceC(Node& sentence, Node& ranges, int index);
+	bool unrollSentenceP(Node& sentence, Node& ranges, bool& success);
+	const CompiledSentence& compileSentence(Node& sentence);
+	bool compileExpressions(Node& node, const std::vector<std::string>& slotNames, bool feature, std::vector<std::pair<Node*,Bytecode*>>& compiled);
+	void storeSlots();
 	bool unrollMembraneStructure(Node& sentence, Membrane& membrane);
 	bool unrollExtendMembraneStructure(Node& sentence, Membrane& membrane);
 	bool unrollMultiset(Node& sentence, Multiset& multiset);
 	bool unrollMultiset(Node& sentence);
+	bool addMultiset(Node& sentence, const Label& label, const Multiset& multiset, int type);
 	bool unrollRule(Node& sentence, const std::string& patternGroup = "");
+	bool addRule(Node& sentence, Rule& rule);
+	bool containsRule(const Rule& rule) const;
+	void insertRule(const Rule& rule);
 	bool unrollCharge(Node& sentence, char& charge, const std::string& patternGroup = ""); 
 	bool unrollLeftHandRule(Node& sentence, LHR& lhr, const std::string& patternGroup = "");
 	bool unrollRightHandRule(Node& sentence, RHR& rhr,  const std::string& patternGroup = "", const Label& defaultLabel = std::vector<LabelString>());
@@ -129,15 +176,25 @@ private:
 	Node* getModule(const std::string& name, int parameters) const;
 		
 	bool getVariableAsString(Node& variable, std::string& str);
+	bool getObject(Node& variable, ObjectString& object);
 	static std::string& getModuleAsString(const Node& module, std::string& str);
 	bool unrollLabels(Node& node, Label& label);
 	static bool findMembrane(const Label& label, const Membrane& membrane);
 	void finishMessage() const;	
+	bool compileFiles();
+	void finish() const;
 	bool checkData();
+	bool prune();
 	bool generateOutput();
 	bool addSemantics();
 
+	// shape of a rule, patterns with other shapes cannot match it
+	typedef std::vector<int> Shape;
+	typedef std::pair<const std::string*, const Rule*> CandidatePattern;
 	bool checkRule(Rule& rule,  const YYLTYPE& location);
+	static void getShape(const Rule& rule, Shape& shape);
+	static bool matchShape(const Shape& shape, const Rule& pattern);
+	const std::vector<CandidatePattern>& getCandidatePatterns(const Rule& rule);
 	bool matchRule(const Rule& rule, const Rule& pattern);
 	bool matchLHR(const LHR& ruleLHR, const LHR& patternLHR, Match& match);
 	bool matchRHR(const RHR& ruleRHR, const RHR& patternRHR, Match& match);
@@ -164,15 +221,45 @@ private:
 	int errorCounter;
 	int warningCounter;
 	int verbosityLevel;
+	// syntax trees of the parse, declared before the nodes which use it
+	Arena arena;
 	Node root;
 	Node mainCall;
 	Memory memory;
 	std::map<std::string, Node*> modules;
 	std::map<std::string, std::set<Rule>> patterns;
+	// patterns which can match every shape, in the order of the groups
+	std::map<Shape, std::vector<CandidatePattern>> patternCache;
+	SharedMutex patternMutex; // shared to look up the cache, exclusive to add a shape
 	std::map<std::string, Semantics> models;
 	
+	static const CompiledSentence WALKED_SENTENCE;
+	std::map<const Node*, CompiledSentence> compiledSentences;
+	static thread_local Unrolling* unrolling;
+	WorkerPool workers;
+	
+	// objects named by an identifier and the values of its indexes, by the hash of both;
+	// every thread keeps its own table, so the names are found without locking
+	struct ComposedName {
+		unsigned key; // position in keys of the number of indexes of every {} and their values
+		unsigned size;
+		ObjectString object;
+	};
+	struct ComposedNames {
+		ComposedNames() : compilation(0) {}
+		unsigned compilation; // the table is cleared when it belongs to a previous compilation
+		std::unordered_multimap<std::size_t, ComposedName> names;
+		std::vector<long> keys;
+	};
+	static thread_local ComposedNames composedNames;
+	unsigned compilation;
+	
 	bool hasStructure;
+	bool pruning;
 	File file;
+	// with --stream the rules are kept in the spool instead of the P system
+	bool streaming;
+	RuleSpool spool;
 	
 	std::string outputFormat;
 	std::string outputFile;
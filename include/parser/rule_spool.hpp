@@ -0,0 +1,350 @@
+#ifndef _RULE_SPOOL_HPP_
+#define _RULE_SPOOL_HPP_
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <stdexcept>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <unordered_map>
+#include <unistd.h>
+#include <serialization.hpp>
+
+namespace plingua { namespace parser {
+
+// Temporary file holding the rules of a P system while they are unrolled, so they are
+// written to the output without keeping them in memory. Only the structural hashes of
+// the rules are kept, a rule is read back to compare it with a new rule of the same hash.
+// forEach gives the rules in insertion order.
+class RuleSpool
+{
+public:
+	RuleSpool() : file(NULL), end(0), rules(0), writing(false) {}
+	~RuleSpool() {close();}
+	RuleSpool(RuleSpool const&) = delete;
+	void operator=(RuleSpool const&) = delete;
+
+	// create the backing temporary file
+	void open();
+	void close();
+	bool isOpen() const {return file != NULL;}
+
+	// false if the spool already contains an equal rule
+	bool insert(const Rule& rule);
+	std::size_t count(const Rule& rule) const {return find(rule, hashValue(rule)) ? 1 : 0;}
+	std::size_t size() const {return rules;}
+
+	// call f(rule) for every rule
+	template<class F> void forEach(F f) const;
+
+private:
+	static const std::size_t BUFFER_SIZE = 1 << 20;
+	typedef std::unordered_map<const std::string*, uint32_t> Ids;
+
+	bool find(const Rule& rule, std::size_t hash) const;
+	void seek(uint64_t offset) const;
+	void read(Rule& rule) const;
+	void encode(const Rule& rule);
+	void encode(const Multiset& multiset);
+	void encode(const Label& label);
+	void encode(const IMembrane& membrane);
+	void encode(const OMembrane& membrane);
+	void decode(const char*& p, Rule& rule) const;
+	void decode(const char*& p, Multiset& multiset) const;
+	void decode(const char*& p, Label& label) const;
+	void decode(const char*& p, IMembrane& membrane) const;
+	void decode(const char*& p, OMembrane& membrane) const;
+	template<class T> void put(T value) {buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));}
+	template<class T> static T get(const char*& p) {T value; memcpy(&value, p, sizeof(T)); p += sizeof(T); return value;}
+	template<class T> static uint32_t getId(const T& str, Ids& ids, std::vector<T>& table);
+
+	std::FILE* file;
+	uint64_t end;
+	std::size_t rules;
+	mutable bool writing;
+	mutable std::string buffer;
+	std::unordered_multimap<std::size_t, uint64_t> index; // offsets of the rules by hash
+	Ids objectIds;
+	std::vector<ObjectString> objects;
+	Ids labelIds;
+	std::vector<LabelString> labels;
+	Ids featureIds;
+	std::vector<FeatureString> features;
+};
+
+
+inline
+void RuleSpool::open()
+{
+	close();
+	char name[] = "/tmp/plingua-rules-XXXXXX";
+	int fd = mkstemp(name);
+	if (fd != -1) {
+		unlink(name);
+		file = fdopen(fd, "w+b");
+		if (file == NULL) {
+			::close(fd);
+		}
+	}
+	if (file == NULL) {
+		throw std::runtime_error("unable to create the rule spool file");
+	}
+	setvbuf(file, NULL, _IOFBF, BUFFER_SIZE);
+	writing = true;
+}
+
+inline
+void RuleSpool::close()
+{
+	if (file != NULL) {
+		fclose(file);
+	}
+	file = NULL;
+	end = 0;
+	rules = 0;
+	writing = false;
+	buffer.clear();
+	index.clear();
+	objectIds.clear();
+	objects.clear();
+	labelIds.clear();
+	labels.clear();
+	featureIds.clear();
+	features.clear();
+}
+
+inline
+bool RuleSpool::insert(const Rule& rule)
+{
+	std::size_t hash = hashValue(rule);
+	if (find(rule, hash)) {
+		return false;
+	}
+	buffer.clear();
+	encode(rule);
+	if (!writing) {
+		// a stream has to be positioned between reading and writing
+		seek(end);
+		writing = true;
+	}
+	uint32_t length = buffer.size();
+	if (fwrite(&length, sizeof(length), 1, file) != 1 || fwrite(buffer.data(), 1, length, file) != length) {
+		throw std::runtime_error("unable to write the rule spool file");
+	}
+	index.emplace(hash, end);
+	end += sizeof(length) + length;
+	rules++;
+	return true;
+}
+
+inline
+bool RuleSpool::find(const Rule& rule, std::size_t hash) const
+{
+	auto range = index.equal_range(hash);
+	for (auto it = range.first; it != range.second; ++it) {
+		Rule aux;
+		seek(it->second);
+		read(aux);
+		if (aux == rule) {
+			return true;
+		}
+	}
+	return false;
+}
+
+template<class F>
+void RuleSpool::forEach(F f) const
+{
+	if (rules == 0) {
+		return;
+	}
+	seek(0);
+	for (std::size_t i = 0; i < rules; i++) {
+		Rule rule;
+		read(rule);
+		f(rule);
+	}
+}
+
+inline
+void RuleSpool::seek(uint64_t offset) const
+{
+	if (fseeko(file, offset, SEEK_SET) != 0) {
+		throw std::runtime_error("unable to seek the rule spool file");
+	}
+	writing = false;
+}
+
+inline
+void RuleSpool::read(Rule& rule) const
+{
+	uint32_t length;
+	if (fread(&length, sizeof(length), 1, file) != 1) {
+		throw std::runtime_error("unable to read the rule spool file");
+	}
+	buffer.resize(length);
+	if (fread(&buffer[0], 1, length, file) != length) {
+		throw std::runtime_error("unable to read the rule spool file");
+	}
+	const char* p = buffer.data();
+	decode(p, rule);
+}
+
+template<class T>
+uint32_t RuleSpool::getId(const T& str, Ids& ids, std::vector<T>& table)
+{
+	auto it = ids.find(&str.str());
+	if (it != ids.end()) {
+		return it->second;
+	}
+	uint32_t id = table.size();
+	ids.emplace(&str.str(), id);
+	table.push_back(str);
+	return id;
+}
+
+inline
+void RuleSpool::encode(const Multiset& multiset)
+{
+	put<uint32_t>(multiset.size());
+	for (auto it = multiset.begin(); it != multiset.end(); ++it) {
+		put<uint32_t>(getId(it->first, objectIds, objects));
+		put<uint64_t>(it->second.raw());
+	}
+}
+
+inline
+void RuleSpool::encode(const Label& label)
+{
+	put<uint32_t>(label.size());
+	for (const LabelString& str : label) {
+		put<uint32_t>(getId(str, labelIds, labels));
+	}
+}
+
+inline
+void RuleSpool::encode(const IMembrane& membrane)
+{
+	put<char>(membrane.charge);
+	encode(membrane.label);
+	encode(membrane.multiset);
+}
+
+inline
+void RuleSpool::encode(const OMembrane& membrane)
+{
+	encode(static_cast<const IMembrane&>(membrane));
+	put<uint32_t>(membrane.data.size());
+	for (const IMembrane& child : membrane.data) {
+		encode(child);
+	}
+}
+
+inline
+void RuleSpool::encode(const Rule& rule)
+{
+	put<char>(rule.arrow);
+	encode(rule.lhr.multiset);
+	encode(rule.lhr.membrane);
+	encode(rule.rhr.multiset);
+	put<uint32_t>(rule.rhr.data.size());
+	for (const OMembrane& membrane : rule.rhr.data) {
+		encode(membrane);
+	}
+	put<uint32_t>(rule.features.size());
+	for (auto it = rule.features.begin(); it != rule.features.end(); ++it) {
+		put<uint32_t>(getId(it->first, featureIds, features));
+		put<uint8_t>(it->second.type());
+		if (it->second.type() == Value::STRING) {
+			uint32_t length = strlen(it->second.as_string());
+			put<uint32_t>(length);
+			buffer.append(it->second.as_string(), length);
+		} else if (it->second.type() == Value::DOUBLE) {
+			put<double>(it->second.as_double());
+		} else {
+			put<int64_t>(it->second.cast_long());
+		}
+	}
+}
+
+inline
+void RuleSpool::decode(const char*& p, Multiset& multiset) const
+{
+	uint32_t size = get<uint32_t>(p);
+	for (uint32_t i = 0; i < size; i++) {
+		uint32_t id = get<uint32_t>(p);
+		uint64_t multiplicity = get<uint64_t>(p);
+		// entries were saved in order
+		multiset.emplace_hint(multiset.end(), objects[id], Multiplicity(multiplicity));
+	}
+}
+
+inline
+void RuleSpool::decode(const char*& p, Label& label) const
+{
+	uint32_t size = get<uint32_t>(p);
+	label.reserve(size);
+	for (uint32_t i = 0; i < size; i++) {
+		label.push_back(labels[get<uint32_t>(p)]);
+	}
+}
+
+inline
+void RuleSpool::decode(const char*& p, IMembrane& membrane) const
+{
+	membrane.charge = get<char>(p);
+	decode(p, membrane.label);
+	decode(p, membrane.multiset);
+}
+
+inline
+void RuleSpool::decode(const char*& p, OMembrane& membrane) const
+{
+	decode(p, static_cast<IMembrane&>(membrane));
+	membrane.data.resize(get<uint32_t>(p));
+	for (IMembrane& child : membrane.data) {
+		decode(p, child);
+	}
+}
+
+inline
+void RuleSpool::decode(const char*& p, Rule& rule) const
+{
+	rule.arrow = get<char>(p);
+	decode(p, rule.lhr.multiset);
+	decode(p, rule.lhr.membrane);
+	decode(p, rule.rhr.multiset);
+	rule.rhr.data.resize(get<uint32_t>(p));
+	for (OMembrane& membrane : rule.rhr.data) {
+		decode(p, membrane);
+	}
+	uint32_t size = get<uint32_t>(p);
+	for (uint32_t i = 0; i < size; i++) {
+		Value& value = rule.features[features[get<uint32_t>(p)]];
+		Value::Type type = (Value::Type)get<uint8_t>(p);
+		if (type == Value::STRING) {
+			uint32_t length = get<uint32_t>(p);
+			value = std::string(p, length);
+			p += length;
+		} else if (type == Value::DOUBLE) {
+			value = get<double>(p);
+		} else {
+			int64_t aux = get<int64_t>(p);
+			switch (type) {
+				case Value::CHAR:   value = (char)aux; break;
+				case Value::UCHAR:  value = (unsigned char)aux; break;
+				case Value::SHORT:  value = (short)aux; break;
+				case Value::USHORT: value = (unsigned short)aux; break;
+				case Value::INT:    value = (int)aux; break;
+				case Value::UINT:   value = (unsigned int)aux; break;
+				default:            value = (long)aux; break;
+			}
+		}
+	}
+}
+
+}}
+
+#endif
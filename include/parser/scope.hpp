@@ -3,7 +3,8 @@
 
 #include <unordered_map>
 #include <string>
-#include <stack>
+#include <vector>
+#include <deque>
 #include <cstdio>
 #include <parser/syntax_tree.hpp>
 #include <parser/node_value.hpp>
@@ -11,31 +12,6 @@
 namespace plingua{ namespace parser
 {
 
-template<size_t SIZE, class A, class B>
-class TStack	
-{
-public:
-	struct T {
-		A a;
-		B b;
-		void clear() {
-			a.clear();
-			b.clear();
-		}
-	};
-	bool empty() const {return sp==0;}
-	size_t size() const {return sp;}
-	const A& topA() const {return s[sp-1].a;}
-	const B& topB() const {return s[sp-1].b;}
-	void push(const A& a, const B& b) {s[sp].a = a; s[sp++].b = b;}
-	void pop() {s[--sp].clear();}
-private:
-	T s[SIZE];
-	size_t sp;
-};
-
-typedef TStack<1024*1024, std::string, NodeValue> Stack;
-
 class Scope
 {
 public:
@@ -44,33 +20,47 @@ public:
 	const NodeValue& getVariable(const std::string& variable) const;
 	bool containsVariable(const std::string& variable) const;
 	void print(FILE* fp, const std::string& prefix = "") const;
-	void saveToStack(Stack& stack);
-	void loadFromStack(Stack& stack);
 	void clear();
 private:
 	std::unordered_map<std::string, NodeValue> scope;
 };
 
+// Local variables of the module calls live in frames of a stack of slots, which grows on demand.
+// Every name is indexed by its last slot and every slot keeps the slot it hides, so a call pushes
+// the base of a frame and returning restores the names of the frame, without copying scopes.
 class Memory
 {
 public:
-	Memory() : counter(0) {}
+	Memory() {}
 	const NodeValue& getVariable(const std::string& variable, const YYLTYPE& loc = YYLTYPE()) const;
 	const NodeValue& setVariable(const std::string& variable, const NodeValue& value, const YYLTYPE& loc);
-	bool containsLocalVariable(const std::string& variable) const {return counter>0 && localScope.containsVariable(variable);}
+	bool containsLocalVariable(const std::string& variable) const {return getLocalSlot(variable)!=NO_SLOT;}
 	bool containsGlobalVariable(const std::string& variable) const {return globalScope.containsVariable(variable);}
 	void clear();
-	unsigned getCounter() const {return counter;}
+	unsigned getCounter() const {return frames.size();}
 	void pushScope();
 	void popScope();
 	void printMemory(FILE* fp) const;
 	const NodeValue& getSystemConstant(const std::string& variable, const YYLTYPE& loc) const;
 private:
+	static const unsigned NO_SLOT = ~0u;
+	typedef std::unordered_map<std::string, unsigned> Names;
+	struct Slot {
+		Names::value_type* name;  // the name and its last slot
+		unsigned hidden;  // previous slot of the name, or NO_SLOT
+		NodeValue value;
+	};
+	
+	// slot of a variable in the current frame, or NO_SLOT
+	unsigned getLocalSlot(const std::string& variable) const;
+	const NodeValue& setLocalVariable(const std::string& variable, const NodeValue& value);
 	
-	unsigned counter;
 	Scope globalScope;
-	Scope localScope;
-	Stack stack;
+	Names names;
+	// slots above top are kept to be reused, the deque does not move the values
+	std::deque<Slot> slots;
+	unsigned top = 0;
+	std::vector<unsigned> frames;
 };
 
 
@@ -1,7 +1,7 @@
 #ifndef _SYNTAX_TREE_HPP_
 #define _SYNTAX_TREE_HPP_
 
-#include <vector>
+#include <cstddef>
 #include <parser/node_value.hpp>
 
 #define YYLTYPE_IS_DECLARED
@@ -41,41 +41,51 @@ typedef struct YYLTYPE
 
 namespace plingua{namespace parser{
 
+class Bytecode;
 
+
+// Nodes are allocated in the arena of the parser, with their children and string values,
+// and they are released all at once when the parser is initialized
 class Node
 {
 public:	
-	Node() : type(0) {}
-	Node(int type) : type(type) {}	
-	Node(int type, long value) :type(type), value(value) {}
-	Node(int type, double value) :type(type), value(value) {}
-	Node(int type, char* value) : type(type), value(value) {}
-	Node(int type, Node* child) : type(type) {addChild(child);}
+	Node() : type(0), childs(NULL), count(0), capacity(0), bytecode(NULL) {}
+	Node(int type) : type(type), childs(NULL), count(0), capacity(0), bytecode(NULL) {}	
+	Node(int type, long value) :type(type), value(value), childs(NULL), count(0), capacity(0), bytecode(NULL) {}
+	Node(int type, double value) :type(type), value(value), childs(NULL), count(0), capacity(0), bytecode(NULL) {}
+	// the string is in the arena, it is not copied
+	Node(int type, char* value) : type(type), value(NodeValue::view(value)), childs(NULL), count(0), capacity(0), bytecode(NULL) {}
+	Node(int type, Node* child) : Node(type) {addChild(child);}
 	Node(int type, Node* child0, Node* child1) 
-	: type(type) {addChild(child0);addChild(child1);}
+	: Node(type) {addChild(child0);addChild(child1);}
 	Node(int type, Node* child0, Node* child1, Node* child2) 
-	: type(type) {addChild(child0);addChild(child1);addChild(child2);}
+	: Node(type) {addChild(child0);addChild(child1);addChild(child2);}
 	Node(int type, Node* child0, Node* child1, Node* child2, Node* child3) 
-	: type(type) {addChild(child0);addChild(child1);addChild(child2);addChild(child3);}
+	: Node(type) {addChild(child0);addChild(child1);addChild(child2);addChild(child3);}
 	Node(int type, Node* child0, Node* child1, Node* child2, Node* child3, Node* child4) 
-	: type(type)  {addChild(child0);addChild(child1);addChild(child2);addChild(child3);addChild(child4);}
+	: Node(type) {addChild(child0);addChild(child1);addChild(child2);addChild(child3);addChild(child4);}
 	Node(int type, Node* child0, Node* child1, Node* child2, Node* child3, Node* child4, Node* child5) 
-	: type(type)  {addChild(child0);addChild(child1);addChild(child2);addChild(child3);addChild(child4);addChild(child5);}
+	: Node(type) {addChild(child0);addChild(child1);addChild(child2);addChild(child3);addChild(child4);addChild(child5);}
 	Node(int type, Node* child0, Node* child1, Node* child2, Node* child3, Node* child4, Node* child5, Node* child6) 
-	: type(type)  {addChild(child0);addChild(child1);addChild(child2);addChild(child3);addChild(child4);addChild(child5);addChild(child6);}
+	: Node(type) {addChild(child0);addChild(child1);addChild(child2);addChild(child3);addChild(child4);addChild(child5);addChild(child6);}
 	
+	// the children are not destroyed, the arena destroys every node
 	virtual ~Node();
+	Node(const Node&) = delete;
+	void operator=(const Node&) = delete;
+	static void* operator new(std::size_t size);
+	static void operator delete(void*) {}
 	Node* setType(int type) {Node::type = type; return this;}
 	int getType() const {return type;}
 	const char* getTypeAsString() const;
 	void setValue(const NodeValue& value) {Node::value = value;}
 	const NodeValue& getValue() const {return value;}
-	int size() const {return childs.size();}
+	int size() const {return count;}
 	const Node* getChild(int index) const {return childs[index];}
 	Node* getChild(int index) {return childs[index];}
 	const Node& operator[](int index) const {return *(childs[index]);}
 	Node& operator[](int index) {return *(childs[index]);}
-	Node* addChild(Node* child) {if (child!=NULL) childs.push_back(child); return this;}
+	Node* addChild(Node* child);
 	void removeChild(int index);
 	const YYLTYPE& getLocation() const {return loc;}
 	void clear();
@@ -90,13 +100,20 @@ public:
 	Node* setLoc(const Node* other) {loc.set(other->loc,other->loc);return this;}
 	
 	bool isExpression() const;
+	
+	// compiled form of the expression, owned by the node
+	const Bytecode* getBytecode() const {return bytecode;}
+	void setBytecode(Bytecode* bytecode);
 private:
 	static void print(FILE* fp, const Node* node, int tabs) ;
 	
 	int type;
 	NodeValue value;
 	YYLTYPE loc;
-	std::vector<Node*> childs;
+	Node** childs;
+	int count;
+	int capacity;
+	Bytecode* bytecode;
 };
 
 }}
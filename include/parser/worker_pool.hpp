@@ -0,0 +1,141 @@
+#ifndef _WORKER_POOL_HPP_
+#define _WORKER_POOL_HPP_
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <pthread.h>
+
+namespace plingua{ namespace parser
+{
+
+// Threads running the tasks of a parallel loop, the calling thread runs tasks
+// too and run() returns when all of them are finished
+class WorkerPool
+{
+public:
+	WorkerPool() : task(NULL), tasks(0), next(0), pending(0), stopping(false) {}
+	~WorkerPool() {stop();}
+	WorkerPool(const WorkerPool&) = delete;
+	void operator=(const WorkerPool&) = delete;
+
+	// threads besides the calling one, running threads are kept if there are already n
+	void start(unsigned n)
+	{
+		if (n == threads.size()) {
+			return;
+		}
+		stop();
+		stopping = false;
+		for (unsigned i=0;i<n;i++) {
+			threads.emplace_back(&WorkerPool::work,this);
+		}
+	}
+
+	void stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+		threads.clear();
+	}
+
+	unsigned size() const {return threads.size()+1;}
+
+	// call f(0) ... f(n-1), tasks are claimed in order but can finish in any order
+	void run(unsigned n, const std::function<void(unsigned)>& f)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		task = &f;
+		tasks = n;
+		next = 0;
+		pending = n;
+		wake.notify_all();
+		while (next < tasks) {
+			runTask(lock);
+		}
+		done.wait(lock,[this]{return pending==0;});
+		task = NULL;
+		tasks = 0;
+		next = 0;
+	}
+
+private:
+	void work()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			wake.wait(lock,[this]{return stopping || next < tasks;});
+			if (stopping) {
+				return;
+			}
+			runTask(lock);
+		}
+	}
+
+	// the lock is released while the task runs
+	void runTask(std::unique_lock<std::mutex>& lock)
+	{
+		unsigned i = next++;
+		const std::function<void(unsigned)>* f = task;
+		lock.unlock();
+		(*f)(i);
+		lock.lock();
+		if (--pending==0) {
+			done.notify_all();
+		}
+	}
+
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	const std::function<void(unsigned)>* task;
+	unsigned tasks;
+	unsigned next;
+	unsigned pending;
+	bool stopping;
+};
+
+// Readers-writer lock (std::shared_mutex needs C++17), lock() and unlock() are
+// exclusive so it can be used with std::lock_guard
+class SharedMutex
+{
+public:
+	SharedMutex() {pthread_rwlock_init(&rwlock,NULL);}
+	~SharedMutex() {pthread_rwlock_destroy(&rwlock);}
+	SharedMutex(const SharedMutex&) = delete;
+	void operator=(const SharedMutex&) = delete;
+
+	void lock() {pthread_rwlock_wrlock(&rwlock);}
+	void unlock() {pthread_rwlock_unlock(&rwlock);}
+	void lock_shared() {pthread_rwlock_rdlock(&rwlock);}
+	void unlock_shared() {pthread_rwlock_unlock(&rwlock);}
+
+private:
+	pthread_rwlock_t rwlock;
+};
+
+// shared ownership of a SharedMutex in a scope
+class SharedLock
+{
+public:
+	explicit SharedLock(SharedMutex& mutex) : mutex(mutex) {mutex.lock_shared();}
+	~SharedLock() {mutex.unlock_shared();}
+	SharedLock(const SharedLock&) = delete;
+	void operator=(const SharedLock&) = delete;
+
+private:
+	SharedMutex& mutex;
+};
+
+}}
+
+#endif
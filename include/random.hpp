@@ -3,12 +3,98 @@
 #define _RANDOM_HPP_
 #include <random>
 #include <chrono>
+#include <vector>
+#include <cstdint>
+
+/**
+ * class Xoshiro256
+ *
+ * The xoshiro256** generator by Blackman and Vigna, seeded with splitmix64.
+ * jump() advances the state by 2^128 draws, so a seed can be split into
+ * 2^128 non-overlapping streams.
+ * It satisfies UniformRandomBitGenerator, so it can be used with the
+ * distributions of <random>.
+ */
+
+class Xoshiro256
+{
+public:
+	typedef uint64_t result_type;
+	static constexpr result_type min() {return 0;}
+	static constexpr result_type max() {return UINT64_MAX;}
+	explicit Xoshiro256(uint64_t seed = 0) {this->seed(seed);}
+	/**
+	 * Reset the state from a seed
+	 * @param seed: the seed
+	 */
+	void seed(uint64_t seed);
+	/**
+	 * Get the next random 64-bit word
+	 * @return: A random word
+	 */
+	result_type operator()();
+	/**
+	 * Advance the state by 2^128 draws
+	 */
+	void jump();
+private:
+	static uint64_t rotl(uint64_t x, int k) {return (x << k) | (x >> (64 - k));}
+	uint64_t s[4];
+};
+
+inline
+void Xoshiro256::seed(uint64_t seed)
+{
+	for (int i = 0; i < 4; i++) {
+		uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		s[i] = z ^ (z >> 31);
+	}
+}
+
+inline
+Xoshiro256::result_type Xoshiro256::operator()()
+{
+	const uint64_t result = rotl(s[1] * 5, 7) * 9;
+	const uint64_t t = s[1] << 17;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 45);
+	return result;
+}
+
+inline
+void Xoshiro256::jump()
+{
+	static const uint64_t JUMP[] = {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+	uint64_t t[4] = {0, 0, 0, 0};
+	for (int i = 0; i < 4; i++) {
+		for (int b = 0; b < 64; b++) {
+			if (JUMP[i] & ((uint64_t)1 << b)) {
+				for (int j = 0; j < 4; j++) {
+					t[j] ^= s[j];
+				}
+			}
+			(*this)();
+		}
+	}
+	for (int j = 0; j < 4; j++) {
+		s[j] = t[j];
+	}
+}
 
 /**
  * class RandomNumberGenerator
  *
- * A Random Number Generator based on std::mt19937 
- * impemented by using the singleton pattern 
+ * A Random Number Generator based on Xoshiro256.
+ * Every generator draws from one stream of a seed. Generators with the same
+ * seed and different streams are independent, so each thread or run can own
+ * one and the results only depend on the seed and the stream numbers.
+ * A process-wide instance is available by using the singleton pattern
  *
  * @author Ignacio Perez
  */
@@ -16,6 +102,13 @@
 class RandomNumberGenerator
 {
 public:
+	/**
+	 * Create a generator for a stream of a seed
+	 * @param seed: the seed, an initial seed based on std::chrono will be used by default
+	 * @param stream: the stream number
+	 */
+	explicit RandomNumberGenerator(unsigned seed = std::chrono::system_clock::now().time_since_epoch().count(), unsigned stream = 0)
+	: uniformDist(0.0,1.0) {setSeed(seed, stream);}
 	RandomNumberGenerator(RandomNumberGenerator const&) = delete;
         void operator=(RandomNumberGenerator const&)  = delete;
 	~RandomNumberGenerator() {}
@@ -32,18 +125,23 @@ public:
 	#define RANDOM RandomNumberGenerator::getInstance()
 	/**
    	 * Get the seed of the random number generator
-	 * Note: An initial seed based on std::chrono will be used
 	 * @return the seed
    	 */
 	unsigned getSeed() const {return seed;}
+	/**
+   	 * Get the stream of the random number generator
+	 * @return the stream number
+   	 */
+	unsigned getStream() const {return stream;}
 	/**
    	 * Set the seed of the random number generator
 	 * @param seed: the new seed
+	 * @param stream: the stream number
    	 */
-	void setSeed(unsigned seed) {this->seed = seed; gen.seed(seed);}
+	void setSeed(unsigned seed, unsigned stream = 0);
 	/**
    	 * Get a random discrete number 0 <= x < size following an uniform distribution
-	 * @param size: the upper bound for the number (excluded)
+	 * @param size: the upper bound for the number (excluded), 0 for the whole range
 	 * @return: A random discrete number
    	 */
 	unsigned operator()(unsigned size);
@@ -59,18 +157,67 @@ public:
 	 * @return: A random real number
    	 */
 	double operator()(double mean, double stddev);
+	/**
+	 * Get a random number of successes following a binomial distribution, in O(1) expected time
+	 * @param trials: the number of trials
+	 * @param p: the probability of success of every trial
+	 * @return: A random number 0 <= x <= trials
+	 */
+	std::size_t binomial(std::size_t trials, double p);
+	/**
+	 * Fill a buffer with raw random words, to be mapped into ranges by using bound()
+	 * @param words: the buffer, resized to count
+	 * @param count: the number of words
+	 */
+	void fill(std::vector<uint32_t>& words, std::size_t count);
+	/**
+	 * Map a raw random word to a discrete number 0 <= x < size (multiply-shift)
+	 * @param word: a random word from fill()
+	 * @param size: the upper bound for the number (excluded)
+	 * @return: A random discrete number
+	 */
+	static unsigned bound(uint32_t word, unsigned size) {return ((uint64_t)word * size) >> 32;}
+	/**
+	 * Get the underlying generator, to be used with the distributions of <random>
+	 * @return the generator
+	 */
+	Xoshiro256& getEngine() {return gen;}
 private:
-	RandomNumberGenerator(): seed(std::chrono::system_clock::now().time_since_epoch().count()), gen(seed), uniformDist(0.0,1.0) {} 
 	unsigned seed;
-	std::mt19937 gen;
+	unsigned stream;
+	Xoshiro256 gen;
 	std::uniform_real_distribution<double> uniformDist;
 };
 
+inline
+void RandomNumberGenerator::setSeed(unsigned seed, unsigned stream)
+{
+	this->seed = seed;
+	this->stream = stream;
+	gen.seed(seed);
+	for (unsigned i = 0; i < stream; i++) {
+		gen.jump();
+	}
+	uniformDist.reset();
+}
+
 inline
 unsigned RandomNumberGenerator::operator()(unsigned size)
 {
-	std::uniform_int_distribution<unsigned> distribution(0,size-1);
-	return distribution(gen);
+	if (size == 0) {
+		return gen() >> 32;
+	}
+	// multiply-shift, rejecting the values that would bias the result (Lemire)
+	uint64_t m = (gen() >> 32) * size;
+	uint32_t low = (uint32_t)m;
+	if (low < size) {
+		uint32_t threshold = (uint32_t)(-size) % size;
+		while (low < threshold) {
+			m = (gen() >> 32) * size;
+			low = (uint32_t)m;
+		}
+	}
+	return m >> 32;
 }
 
 inline
@@ -80,5 +227,33 @@ double RandomNumberGenerator::operator()(double mean, double stddev)
 	return distribution(gen);
 }
 
+inline
+std::size_t RandomNumberGenerator::binomial(std::size_t trials, double p)
+{
+	if (trials == 0 || p <= 0.0) {
+		return 0;
+	}
+	if (p >= 1.0) {
+		return trials;
+	}
+	std::binomial_distribution<std::size_t> distribution(trials,p);
+	return distribution(gen);
+}
+
+inline
+void RandomNumberGenerator::fill(std::vector<uint32_t>& words, std::size_t count)
+{
+	words.resize(count);
+	std::size_t i = 0;
+	for (; i + 1 < count; i += 2) {
+		uint64_t word = gen();
+		words[i] = (uint32_t)word;
+		words[i + 1] = word >> 32;
+	}
+	if (i < count) {
+		words[i] = gen() >> 32;
+	}
+}
+
 
 #endif
@@ -0,0 +1,373 @@
+#ifndef _REACHABILITY_HPP_
+#define _REACHABILITY_HPP_
+
+#include <vector>
+#include <map>
+#include <set>
+#include <string>
+#include <serialization.hpp>
+
+namespace plingua {
+
+// Elements removed from a P system by the reachability analysis
+class PruningReport
+{
+public:
+	std::vector<Rule> rules;        // rules that can never be applied
+	std::set<std::string> objects;  // objects that can never appear in a configuration
+	std::set<Label> labels;         // labels that can never be used
+	bool empty() const {return rules.empty() && objects.empty() && labels.empty();}
+	void clear() {rules.clear(); objects.clear(); labels.clear();}
+};
+
+// Over-approximation of the objects, labels and charges that can appear
+// in any configuration reachable from a given initial configuration.
+// Objects are tracked globally (they can be moved between membranes
+// by communication and dissolution) while charges are tracked per label.
+// Labels are never created by rules, so they are taken from the initial
+// configuration.
+class Reachability
+{
+public:
+	Reachability() {}
+
+	// Prune the P system starting from its own initial configuration
+	void prune(Psystem& psystem, PruningReport& report);
+
+	// Prune the P system starting from a given configuration
+	void prune(Psystem& psystem, const Configuration& configuration, PruningReport& report);
+
+private:
+	typedef std::pair<Label,char> ChargedLabel;
+
+	void clear();
+	void addStructureRec(const Membrane& membrane, const std::map<Label, Multiset>& multisets);
+	void addObjects(const Multiset& multiset);
+	void addObject(const std::string& object);
+	void addChargedLabel(const Label& label, char charge);
+	void addRule(const Rule& rule);
+	void require(unsigned rule, const Multiset& multiset);
+	void require(unsigned rule, const LeafMembrane& membrane);
+	void fire(unsigned rule);
+	void run(Psystem& psystem, PruningReport& report);
+	static void collectObjects(const Rule& rule, std::set<std::string>& objects);
+	static void collectLabels(const Rule& rule, std::set<Label>& labels);
+
+	std::set<std::string> objects;                          // reachable objects
+	std::set<Label> labels;                                 // labels of existing membranes
+	std::set<ChargedLabel> chargedLabels;                   // reachable (label, charge) pairs
+	std::vector<const Rule*> rules;                         // rules of the P system
+	std::vector<unsigned> missing;                          // number of unsatisfied requirements per rule
+	std::vector<bool> fired;                                // applicable rules
+	std::map<std::string, std::vector<unsigned>> waitingObjects;      // rules waiting for an object
+	std::map<ChargedLabel, std::vector<unsigned>> waitingMembranes;   // rules waiting for a charged label
+	std::vector<unsigned> ready;                            // rules with all requirements satisfied
+};
+
+
+
+inline
+void Reachability::clear()
+{
+	objects.clear();
+	labels.clear();
+	chargedLabels.clear();
+	rules.clear();
+	missing.clear();
+	fired.clear();
+	waitingObjects.clear();
+	waitingMembranes.clear();
+	ready.clear();
+}
+
+inline
+void Reachability::prune(Psystem& psystem, PruningReport& report)
+{
+	clear();
+	addStructureRec(psystem.structure, psystem.multisets);
+	run(psystem,report);
+	// Initial multisets for labels without membranes are never used
+	for (auto it = psystem.multisets.begin(); it != psystem.multisets.end();) {
+		if (labels.count(it->first) == 0) {
+			report.labels.insert(it->first);
+			it = psystem.multisets.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+inline
+void Reachability::prune(Psystem& psystem, const Configuration& configuration, PruningReport& report)
+{
+	clear();
+	addObjects(configuration.environment);
+	for (const CMembrane& membrane : configuration.membranes) {
+		if (membrane.parent == -2) {
+			continue;
+		}
+		labels.insert(membrane.label);
+		addChargedLabel(membrane.label,membrane.charge);
+		addObjects(membrane.multiset);
+	}
+	run(psystem,report);
+}
+
+inline
+void Reachability::addStructureRec(const Membrane& membrane, const std::map<Label, Multiset>& multisets)
+{
+	labels.insert(membrane.label);
+	addChargedLabel(membrane.label,membrane.charge);
+	auto it = multisets.find(membrane.label);
+	if (it != multisets.end()) {
+		addObjects(it->second);
+	}
+	for (const Membrane& child : membrane.data) {
+		addStructureRec(child, multisets);
+	}
+}
+
+inline
+void Reachability::addObjects(const Multiset& multiset)
+{
+	for (auto it = multiset.begin(); it != multiset.end(); ++it) {
+		addObject(it->first.str());
+	}
+}
+
+inline
+void Reachability::addObject(const std::string& object)
+{
+	if (!objects.insert(object).second) {
+		return;
+	}
+	auto it = waitingObjects.find(object);
+	if (it == waitingObjects.end()) {
+		return;
+	}
+	for (unsigned rule : it->second) {
+		if (--missing[rule] == 0) {
+			ready.push_back(rule);
+		}
+	}
+	waitingObjects.erase(it);
+}
+
+inline
+void Reachability::addChargedLabel(const Label& label, char charge)
+{
+	ChargedLabel key(label,charge);
+	if (!chargedLabels.insert(key).second) {
+		return;
+	}
+	auto it = waitingMembranes.find(key);
+	if (it == waitingMembranes.end()) {
+		return;
+	}
+	for (unsigned rule : it->second) {
+		if (--missing[rule] == 0) {
+			ready.push_back(rule);
+		}
+	}
+	waitingMembranes.erase(it);
+}
+
+inline
+void Reachability::require(unsigned rule, const Multiset& multiset)
+{
+	for (auto it = multiset.begin(); it != multiset.end(); ++it) {
+		const std::string& object = it->first.str();
+		if (objects.count(object) > 0) {
+			continue;
+		}
+		std::vector<unsigned>& waiting = waitingObjects[object];
+		if (waiting.empty() || waiting.back() != rule) {
+			waiting.push_back(rule);
+			missing[rule]++;
+		}
+	}
+}
+
+inline
+void Reachability::require(unsigned rule, const LeafMembrane& membrane)
+{
+	if (labels.count(membrane.label) == 0) {
+		// No membrane with this label will ever exist
+		missing[rule]++;
+		return;
+	}
+	ChargedLabel key(membrane.label,membrane.charge);
+	if (chargedLabels.count(key) > 0) {
+		return;
+	}
+	std::vector<unsigned>& waiting = waitingMembranes[key];
+	if (waiting.empty() || waiting.back() != rule) {
+		waiting.push_back(rule);
+		missing[rule]++;
+	}
+}
+
+inline
+void Reachability::addRule(const Rule& rule)
+{
+	unsigned id = rules.size();
+	rules.push_back(&rule);
+	missing.push_back(0);
+	fired.push_back(false);
+	require(id, rule.lhr.multiset);
+	require(id, rule.lhr.membrane);
+	require(id, rule.lhr.membrane.multiset);
+	for (const IMembrane& child : rule.lhr.membrane.data) {
+		require(id, child);
+		require(id, child.multiset);
+	}
+	if (rule.arrow == 1) {
+		// The target membrane is looked up by label, whatever its charge
+		for (const OMembrane& target : rule.rhr.data) {
+			if (labels.count(target.label) == 0) {
+				missing[id]++;
+			}
+			require(id, target.multiset);
+		}
+	}
+	if (missing[id] == 0) {
+		ready.push_back(id);
+	}
+}
+
+inline
+void Reachability::fire(unsigned id)
+{
+	const Rule& rule = *rules[id];
+	fired[id] = true;
+	if (rule.arrow == 1) {
+		// Objects are only exchanged between both membranes
+		return;
+	}
+	addObjects(rule.rhr.multiset);
+	for (const OMembrane& membrane : rule.rhr.data) {
+		addChargedLabel(membrane.label,membrane.charge);
+		addObjects(membrane.multiset);
+		for (const IMembrane& child : membrane.data) {
+			addChargedLabel(child.label,child.charge);
+			addObjects(child.multiset);
+		}
+	}
+}
+
+inline
+void Reachability::run(Psystem& psystem, PruningReport& report)
+{
+	for (const Rule& rule : psystem.rules) {
+		addRule(rule);
+	}
+
+	while (!ready.empty()) {
+		unsigned id = ready.back();
+		ready.pop_back();
+		fire(id);
+	}
+
+	std::set<std::string> allObjects;
+	std::set<Label> allLabels;
+	for (unsigned i=0; i<rules.size(); i++) {
+		collectObjects(*rules[i], allObjects);
+		collectLabels(*rules[i], allLabels);
+	}
+
+	std::set<std::string> usedObjects;
+	std::set<Label> usedLabels(labels);
+	for (unsigned i=0; i<rules.size(); i++) {
+		if (fired[i]) {
+			collectObjects(*rules[i], usedObjects);
+			collectLabels(*rules[i], usedLabels);
+		}
+	}
+
+	for (const std::string& object : allObjects) {
+		if (usedObjects.count(object) == 0 && objects.count(object) == 0) {
+			report.objects.insert(object);
+		}
+	}
+	for (const Label& label : allLabels) {
+		if (usedLabels.count(label) == 0) {
+			report.labels.insert(label);
+		}
+	}
+
+	unsigned i = 0;
+	psystem.rules.removeIf([&](const Rule& rule) {
+		if (fired[i++]) {
+			return false;
+		}
+		report.rules.push_back(rule);
+		return true;
+	});
+	rules.clear();
+}
+
+inline
+void Reachability::collectObjects(const Rule& rule, std::set<std::string>& objects)
+{
+	for (auto it = rule.lhr.multiset.begin(); it != rule.lhr.multiset.end(); ++it) {
+		objects.insert(it->first.str());
+	}
+	for (auto it = rule.lhr.membrane.multiset.begin(); it != rule.lhr.membrane.multiset.end(); ++it) {
+		objects.insert(it->first.str());
+	}
+	for (const IMembrane& child : rule.lhr.membrane.data) {
+		for (auto it = child.multiset.begin(); it != child.multiset.end(); ++it) {
+			objects.insert(it->first.str());
+		}
+	}
+	for (auto it = rule.rhr.multiset.begin(); it != rule.rhr.multiset.end(); ++it) {
+		objects.insert(it->first.str());
+	}
+	for (const OMembrane& membrane : rule.rhr.data) {
+		for (auto it = membrane.multiset.begin(); it != membrane.multiset.end(); ++it) {
+			objects.insert(it->first.str());
+		}
+		for (const IMembrane& child : membrane.data) {
+			for (auto it = child.multiset.begin(); it != child.multiset.end(); ++it) {
+				objects.insert(it->first.str());
+			}
+		}
+	}
+}
+
+inline
+void Reachability::collectLabels(const Rule& rule, std::set<Label>& labels)
+{
+	labels.insert(rule.lhr.membrane.label);
+	for (const IMembrane& child : rule.lhr.membrane.data) {
+		labels.insert(child.label);
+	}
+	for (const OMembrane& membrane : rule.rhr.data) {
+		labels.insert(membrane.label);
+		for (const IMembrane& child : membrane.data) {
+			labels.insert(child.label);
+		}
+	}
+}
+
+}
+
+inline
+std::ostream& operator <<(std::ostream& os, const plingua::PruningReport& arg)
+{
+	os << "PRUNED RULES: " << arg.rules.size() << std::endl;
+	for (const plingua::Rule& rule : arg.rules) {
+		os << "\t" << rule << std::endl;
+	}
+	os << "PRUNED OBJECTS: " << arg.objects.size() << std::endl;
+	for (const std::string& object : arg.objects) {
+		os << "\t" << object << std::endl;
+	}
+	os << "PRUNED LABELS: " << arg.labels.size() << std::endl;
+	for (const plingua::Label& label : arg.labels) {
+		os << "\t" << label << std::endl;
+	}
+	return os;
+}
+
+#endif
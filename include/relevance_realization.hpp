@@ -10,6 +10,7 @@
 #include <cmath>
 #include <cstdlib>
 #include "serialization.hpp"
+#include "memory_accounting.hpp"
 
 namespace plingua { namespace rr {
 
@@ -290,6 +291,29 @@ public:
         return edge_count > 0 ? total_strength / edge_count : 0.0;
     }
     
+    // Approximate memory used by the nodes, edges and AAR sets
+    void accountMemory(plingua::MemoryReport& report) const {
+        std::size_t bytes = 0;
+        for (auto it = nodes.begin(); it != nodes.end(); ++it) {
+            const RRNode& node = *it->second;
+            bytes += plingua::memory::TREE_NODE_BYTES + sizeof(*it) + sizeof(RRNode);
+            bytes += plingua::memory::bytes(node.label) + plingua::memory::bytes(node.original_object);
+            bytes += node.rr_properties.size() * (plingua::memory::TREE_NODE_BYTES + sizeof(std::pair<const RRPrimitive, double>));
+            bytes += node.trialectic_state.capacity() * sizeof(double);
+        }
+        report.add("rr/nodes", nodes.size(), bytes);
+        bytes = 0;
+        for (auto it = edges.begin(); it != edges.end(); ++it) {
+            bytes += plingua::memory::TREE_NODE_BYTES + sizeof(*it) + sizeof(RREdge);
+            for (auto p = it->second->properties.begin(); p != it->second->properties.end(); ++p) {
+                bytes += plingua::memory::TREE_NODE_BYTES + sizeof(*p) + plingua::memory::bytes(p->first);
+            }
+        }
+        report.add("rr/edges", edges.size(), bytes);
+        std::size_t members = agent_nodes.size() + arena_nodes.size() + relation_edges.size();
+        report.add("rr/sets", members, members * (plingua::memory::TREE_NODE_BYTES + sizeof(unsigned)));
+    }
+    
 private:
     void createEmergentRelation(unsigned agent_id, unsigned arena_id, unsigned edge_id) {
         // Create new emergent relation node
@@ -82,6 +82,8 @@ private:
             return updateSalience(line);
         } else if (line.find("(find-atom") == 0) {
             return findAtom(line);
+        } else if (line.find("(memory-report)") == 0) {
+            return memoryReport();
         } else {
             return "Unknown command: " + line;
         }
@@ -263,6 +265,24 @@ private:
         }
     }
     
+    // ((name elements bytes) ...) for the RR hypergraph and the AtomSpace
+    std::string memoryReport() {
+        plingua::MemoryReport report;
+        if (rr_hypergraph) rr_hypergraph->accountMemory(report);
+        if (atom_space) atom_space->accountMemory(report);
+        
+        std::ostringstream oss;
+        oss << "(";
+        bool first = true;
+        for (const plingua::MemoryReport::Entry& entry : report.getEntries()) {
+            if (!first) oss << " ";
+            oss << "(" << entry.name << " " << entry.elements << " " << entry.bytes << ")";
+            first = false;
+        }
+        oss << ")";
+        return oss.str();
+    }
+    
     void printHelp() {
         std::cout << "Available commands:" << std::endl;
         std::cout << "  (list-rr-nodes)           - List all RR nodes" << std::endl;
@@ -273,6 +293,7 @@ private:
         std::cout << "  (get-salience node-ID)    - Get salience of node" << std::endl;
         std::cout << "  (update-salience node-ID VALUE) - Update node salience" << std::endl;
         std::cout << "  (find-atom \"NAME\")         - Find atom by name" << std::endl;
+        std::cout << "  (memory-report)           - Memory used by the RR nodes and atoms" << std::endl;
         std::cout << "  help                      - Show this help" << std::endl;
         std::cout << "  quit/exit                 - Exit REPL" << std::endl;
     }
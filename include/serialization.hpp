@@ -3,6 +3,11 @@
 #include <iostream>
 #include <algorithm>
 #include <cstring>
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 #include "cereal/types/vector.hpp"
 #include "cereal/types/map.hpp"
 #include "cereal/types/set.hpp"
@@ -100,30 +105,62 @@ private:
 
 
 
+// Table of interned strings, equal strings share one copy that lives until
+// the end of the program. Every thread keeps the strings it has interned in a
+// cache, so the table is only locked the first time a thread meets a string
+class StringPool
+{
+public:
+	StringPool(StringPool const&) = delete;
+	void operator=(StringPool const&) = delete;
+	static StringPool& getInstance() {
+		static StringPool singleton;
+		return singleton;
+	}
+	#define STRING_POOL StringPool::getInstance()
+
+	const std::string* intern(const std::string& str) {return intern(str.data(),str.size());}
+	const std::string* intern(const char* str)        {return intern(str,strlen(str));}
+	const std::string* intern(const char* str, std::size_t length);
+	const std::string* getEmpty() const {return empty;}
+	std::size_t size() const;
+	// heap bytes of the long strings
+	std::size_t bytes() const;
+private:
+	StringPool() : empty(intern("")) {}
+	std::unordered_set<std::string> strings;
+	mutable std::mutex mutex;
+	const std::string* empty;
+};
+
+// Handle to an interned string, equal strings have the same address
 class String 
 {
 public:
-	String()                        {}
-	String(const std::string& str)  : str_(str) {}
-	String(const char* s)           : str_(s) {}
+	String()                        : str_(STRING_POOL.getEmpty()) {}
+	String(const std::string& str)  : str_(STRING_POOL.intern(str)) {}
+	String(const char* s)           : str_(STRING_POOL.intern(s)) {}
 	virtual ~String() {}
 	
 	String& operator =(const String& other)        {str_ = other.str_; return *this;}
-	String& operator =(const std::string& other)   {str_ = other; return *this;}
-	String& operator =(const char* s)              {str_ = s; return *this;}
+	String& operator =(const std::string& other)   {str_ = STRING_POOL.intern(other); return *this;}
+	String& operator =(const char* s)              {str_ = STRING_POOL.intern(s); return *this;}
 	
-	const std::string& str() const {return str_;}
-	std::string& str() {return str_;}
+	const std::string& str() const {return *str_;}
 	
 	virtual bool operator ==(const String& other) const       {return str_ == other.str_;}
 	virtual bool operator !=(const String& other) const       {return str_ != other.str_;}
-	virtual bool operator  <(const String& other) const       {return str_ < other.str_;}	
+	virtual bool operator  <(const String& other) const       {return str_ != other.str_ && *str_ < *other.str_;}	
 
 	template<class A> void save(A& archive) const;
 	template<class A> void load(A& archive);
 
+protected:
+	// str has to be interned
+	void set(const std::string* str) {str_ = str;}
+
 private:
-	std::string str_;
+	const std::string* str_;
 };
 
 class LabelString : public String
@@ -170,6 +207,12 @@ typedef std::vector<LabelString> Label;
 typedef std::map<ObjectString,Multiplicity> Multiset;
 typedef std::map<FeatureString,Value> Features;
 
+// names used by the parser and the simulators, interned once
+const FeatureString PRIORITY_FEATURE("priority");
+const FeatureString PROBABILITY_FEATURE("probability");
+const FeatureString PATTERN_FEATURE("pattern");
+const ObjectString DISSOLUTION_OBJECT("@d");
+
 // EXTENDED VECTOR CLASS
 template<class T>
 class ExtendedVector {
@@ -185,6 +228,7 @@ class LeafMembrane {
 public:
 	char charge;   // charge < 0; charge == 0; charge > 0;
 	Label label;
+	unsigned labelId; // interned label, assigned by the simulator (not serialized)
 	LeafMembrane();
 	const char* getChargeSymbol() const;
 	bool operator==(const LeafMembrane& other) const;
@@ -257,6 +301,100 @@ public:
 	template<class A> void serialize(A& archive);
 };
 
+// STRUCTURAL HASHES, consistent with operator== (the order of the membranes and the features are ignored)
+std::size_t hashValue(const Label& label);
+std::size_t hashValue(const Multiset& multiset);
+std::size_t hashValue(const IMembrane& membrane);
+std::size_t hashValue(const OMembrane& membrane);
+std::size_t hashValue(const Rule& rule);
+
+// RULE SET CLASS
+// Rules are found by their structural hashes, so inserting does not compare them with
+// the other rules, and iterators give them in the order of Rule::operator<, which is
+// sorted the first time they are iterated after an insertion
+class RuleSet {
+public:
+	class const_iterator {
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef const Rule value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const Rule* pointer;
+		typedef const Rule& reference;
+		const_iterator(const RuleSet* set, std::vector<unsigned>::const_iterator it) : set(set), it(it) {}
+		const Rule& operator*() const {return set->rules[*it];}
+		const Rule* operator->() const {return &set->rules[*it];}
+		const_iterator& operator++() {++it; return *this;}
+		const_iterator operator++(int) {const_iterator aux(*this); ++it; return aux;}
+		bool operator==(const const_iterator& other) const {return it == other.it;}
+		bool operator!=(const const_iterator& other) const {return it != other.it;}
+	private:
+		const RuleSet* set;
+		std::vector<unsigned>::const_iterator it;
+	};
+	typedef const_iterator iterator;
+	typedef Rule value_type;
+
+	RuleSet() : sorted(true) {}
+	// false if the set already contains an equal rule
+	bool insert(const Rule& rule);
+	std::size_t count(const Rule& rule) const {return find(rule, hashValue(rule)) < 0 ? 0 : 1;}
+	std::size_t size() const {return rules.size();}
+	bool empty() const {return rules.empty();}
+	void clear();
+	const_iterator begin() const {sort(); return const_iterator(this, order.begin());}
+	const_iterator end() const {sort(); return const_iterator(this, order.end());}
+	// remove the rules for which remove(rule) is true, they are visited in order
+	template<class P> void removeIf(P remove);
+	// call f(rule) for every rule, in order
+	template<class F> void forEach(F f) const {for (const Rule& rule : *this) f(rule);}
+	template<class A> void save(A& archive) const;
+	template<class A> void load(A& archive);
+private:
+	long find(const Rule& rule, std::size_t hash) const;
+	void sort() const;
+	std::deque<Rule> rules;        // insertion order, a deque does not copy the rules when it grows
+	std::vector<std::size_t> hashes;
+	std::unordered_multimap<std::size_t, unsigned> index;
+	mutable std::vector<unsigned> order;
+	mutable bool sorted;
+};
+
+// RULE FAMILY CLASS
+// Rules of the same shape whose integers (indexes of the objects, labels which are numbers and
+// multiplicities) are affine functions of some parameters. The parameters of the instances take
+// every value of a box, from lower to upper, or they are listed in points. rule is the first
+// instance, the integers in columns (in the order of getShape) of the other instances change
+// by coefficients * (their parameters - the parameters of the first instance).
+class RuleFamily {
+public:
+	Rule rule;
+	std::vector<long> lower;              // bounds of the parameters
+	std::vector<long> upper;
+	std::vector<long> points;             // parameters of every instance, empty for a box
+	std::vector<unsigned> columns;        // integers which change
+	std::vector<long> coefficients;       // coefficients of the parameters for every column
+	std::vector<FeatureString> variables; // features which change
+	std::vector<Value> values;            // values of the variables for every instance
+	std::size_t size() const;
+	// call f(rule) for every instance, the last parameter of a box changes first
+	template<class F> void forEach(F f) const;
+	// split the rules of a source in families and rules left alone
+	template<class S> static void pack(const S& source, RuleSet& rules, std::vector<RuleFamily>& families);
+	// shape of a rule without its integers, the rules of a family have the same shape
+	static void getShape(const Rule& rule, std::string& shape, std::vector<long>& integers);
+	// pattern with other integers, in the order of getShape
+	static void setIntegers(const Rule& pattern, const std::vector<long>& integers, Rule& rule);
+	template<class A> void serialize(A& archive);
+private:
+	struct Group;
+	static void pack(const Group& group, RuleSet& rules, std::vector<RuleFamily>& families);
+	static bool fit(const Group& group, const std::vector<unsigned>& parameters, const std::vector<unsigned>& basis, unsigned column, std::vector<long>& coefficients);
+	static bool getBox(const Group& group, const std::vector<unsigned>& parameters, RuleFamily& family, std::vector<unsigned>& instances);
+	static void getBasis(const Group& group, const std::vector<unsigned>& parameters, std::vector<unsigned>& basis);
+	static void getInstance(const Group& group, unsigned row, Rule& rule);
+};
+
 
 // SEMANTICS CLASS
 class Semantics{
@@ -302,21 +440,64 @@ public:
 	String model;						 // model
 	Membrane structure;                  // initial membrane structure 
 	std::map<Label, Multiset> multisets; // initial multisets 
-	std::set<Rule> rules;		         // rules 
+	RuleSet rules;		                 // rules 
 	Semantics semantics;			     // semantics	
 	Features features;                   // extension features (multienvironment, confluent, etc...)
 	template<class A> void save(A& archive) const;
 	template<class A> void load(A& archive);
+	// save with the rules of another source (see RuleWriter) instead of its rules, and with
+	// the rules packed in families (see RuleFamily) if families is true, they are not save
+	// and load overloads as cereal would take them for versioned functions
+	template<class A, class S> void saveWith(A& archive, const S& source, bool families) const;
+	template<class A> void loadWith(A& archive, bool families);
+};
+
+// RULES OF A SOURCE WITH size() AND forEach(f), WRITTEN AS A RULE SET
+template<class S>
+class RuleWriter {
+public:
+	RuleWriter(const S& source) : source(source) {}
+	template<class A> void save(A& archive) const;
+private:
+	const S& source;
 };
 
 
+// files whose rules are packed in families
+const std::string FAMILIES_FILE_VERSION = "1.1";
+
 // P SYSTEM FILE CLASS
 class File {
 public:	
 	std::string header;
 	std::string version;
 	Psystem psystem;
-	template<class A> void serialize(A& archive);
+	template<class A> void save(A& archive) const;
+	template<class A> void load(A& archive);
+private:
+	struct PsystemLoader {
+		Psystem& psystem;
+		bool families;
+		template<class A> void load(A& archive) {psystem.loadWith(archive, families);}
+	};
+};
+
+// P SYSTEM FILE WRITTEN WITH THE RULES OF ANOTHER SOURCE
+// The source is iterated twice, for the alphabet and for the rules
+template<class S>
+class StreamedFile {
+public:
+	StreamedFile(const File& file, const S& source) : file(file), source(source) {}
+	template<class A> void save(A& archive) const;
+private:
+	struct StreamedPsystem {
+		const Psystem& psystem;
+		const S& source;
+		bool families;
+		template<class A> void save(A& archive) const {psystem.saveWith(archive, source, families);}
+	};
+	const File& file;
+	const S& source;
 };
 
 
@@ -353,10 +534,10 @@ public:
 	}
 	#define ALPHABET Alphabet::getInstance()	
 
-	const UId& getObjectId(const std::string& object) const;
-	const UId& getLabelId(const std::string& label) const;
-	const UId& getFeatureId(const std::string& feature) const;
-	const UId& getStringId(const std::string& str) const;
+	const UId& getObjectId(const String& object) const;
+	const UId& getLabelId(const String& label) const;
+	const UId& getFeatureId(const String& feature) const;
+	const UId& getStringId(const String& str) const;
 	const std::string& getObject(std::size_t id) const;
 	const std::string& getLabel(std::size_t id) const;
 	const std::string& getFeature(std::size_t id) const;
@@ -369,6 +550,7 @@ public:
 	template<class A> void save(A& archive) const;
 	template<class A> void load(A& archive);
 	void load(const Psystem& psystem);
+	template<class S> void load(const Psystem& psystem, const S& rules);
 private:
 	Alphabet() {}
 	void addMultiset(const Multiset& multiset);
@@ -376,14 +558,16 @@ private:
 	void addLabel(const Label& label);
 	void addMembrane(const Membrane& membrane);
 	void sort();
-	std::map<std::string,UId> objects;
-	std::vector<std::string> objects_array;
-	std::map<std::string,UId> labels;
-	std::vector<std::string> labels_array;
-	std::map<std::string,UId> features;
-	std::vector<std::string> features_array;
-	std::map<std::string,UId> strings;
-	std::vector<std::string> strings_array;
+	// the tables are keyed by interned strings
+	typedef std::unordered_map<const std::string*,UId> Ids;
+	Ids objects;
+	std::vector<const std::string*> objects_array;
+	Ids labels;
+	std::vector<const std::string*> labels_array;
+	Ids features;
+	std::vector<const std::string*> features_array;
+	Ids strings;
+	std::vector<const std::string*> strings_array;
 	std::size_t maxMultiplicity;
 };
 
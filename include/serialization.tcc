@@ -1,5 +1,6 @@
 #include <limits>
 #include <fstream>
+#include <cmath>
 #include "cereal/archives/xml.hpp"
 #include "cereal/archives/json.hpp"
 #include "cereal/archives/binary.hpp"
@@ -134,15 +135,56 @@ void Value::clear() {
 	}
 }
 
+inline
+const std::string* StringPool::intern(const char* str, std::size_t length) {
+	// interned strings by a FNV-1a hash, the cache of a thread is never cleared
+	// because the strings of the table are never removed
+	static thread_local std::unordered_multimap<std::size_t, const std::string*> cache;
+	std::size_t hash = 14695981039346656037ULL;
+	for (std::size_t i=0;i<length;i++) {
+		hash = (hash ^ (unsigned char)str[i]) * 1099511628211ULL;
+	}
+	auto range = cache.equal_range(hash);
+	for (auto it = range.first; it != range.second; ++it) {
+		if (it->second->size()==length && memcmp(it->second->data(),str,length)==0) {
+			return it->second;
+		}
+	}
+	const std::string* interned;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		interned = &*strings.emplace(str,length).first;
+	}
+	cache.emplace(hash,interned);
+	return interned;
+}
+
+inline
+std::size_t StringPool::size() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return strings.size();
+}
+
+inline
+std::size_t StringPool::bytes() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::size_t total = 0;
+	for (const std::string& str : strings) {
+		total += str.capacity() > 15 ? str.capacity() + 1 : 0;
+	}
+	return total;
+}
+
 template<class A>
 void String::save(A& archive) const {
-	ALPHABET.getStringId(str_).save(archive);
+	ALPHABET.getStringId(*this).save(archive);
 }
 
+// the strings of the alphabet are interned
 template<class A> 
 void String::load(A& archive) {
 	UId aux(archive, ALPHABET.getStringsAlphabetSize());
-	str_ = ALPHABET.getString(aux.getId()); 
+	str_ = &ALPHABET.getString(aux.getId()); 
 }
 
 
@@ -311,37 +353,37 @@ template<class A> void Multiplicity::load(A& archive) {
 
 template<class A> 
 void LabelString::save(A& archive) const {
-	ALPHABET.getLabelId(str()).save(archive);
+	ALPHABET.getLabelId(*this).save(archive);
 }
 
 template<class A> 
 void LabelString::load(A& archive) {
 	UId aux(archive, ALPHABET.getLabelAlphabetSize());
-	String::operator =(ALPHABET.getLabel(aux.getId()));
+	set(&ALPHABET.getLabel(aux.getId()));
 }
 
 
 template<class A> 
 void ObjectString::save(A& archive) const {
-	ALPHABET.getObjectId(str()).save(archive);
+	ALPHABET.getObjectId(*this).save(archive);
 }
 
 template<class A> 
 void ObjectString::load(A& archive) {
 	UId aux(archive, ALPHABET.getObjectAlphabetSize());
-	String::operator =(ALPHABET.getObject(aux.getId()));
+	set(&ALPHABET.getObject(aux.getId()));
 }
 
 
 template<class A> 
 void FeatureString::save(A& archive) const {
-	ALPHABET.getFeatureId(str()).save(archive);
+	ALPHABET.getFeatureId(*this).save(archive);
 }
 
 template<class A> 
 void FeatureString::load(A& archive) {
 	UId aux(archive, ALPHABET.getFeatureAlphabetSize());
-	String::operator =(ALPHABET.getFeature(aux.getId()));
+	set(&ALPHABET.getFeature(aux.getId()));
 }
 
 inline
@@ -438,6 +480,9 @@ bool ExtendedVector<T>::operator==(const ExtendedVector<T>& other) const {
 	if (data.size() != other.data.size()) {
 		return false;
 	}
+	if (data.size() == 1) {
+		return data[0] == other.data[0];
+	}
 	std::vector<T> aux0(data);
 	std::vector<T> aux1(other.data);
 	std::sort(aux0.begin(),aux0.end());
@@ -453,6 +498,9 @@ bool ExtendedVector<T>::operator<(const ExtendedVector<T>& other) const {
 	if (data.size() > other.data.size()) {
 		return false;
 	}
+	if (data.size() == 1) {
+		return data[0] < other.data[0];
+	}
 	std::vector<T> aux0(data);
 	std::vector<T> aux1(other.data);
 	std::sort(aux0.begin(),aux0.end());
@@ -461,7 +509,7 @@ bool ExtendedVector<T>::operator<(const ExtendedVector<T>& other) const {
 }
 
 inline
-LeafMembrane::LeafMembrane() : charge(0) {}
+LeafMembrane::LeafMembrane() : charge(0), labelId(0) {}
 
 inline
 const char* LeafMembrane::getChargeSymbol() const 
@@ -652,30 +700,719 @@ void Rule::serialize(A& archive) {
 	archive(cereal::make_nvp("features",features));
 }
 
+inline
+std::size_t hashCombine(std::size_t seed, std::size_t hash) {
+	return seed ^ (hash + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+// the membranes of an ExtendedVector are compared as a multiset, so their hashes are added
+inline
+std::size_t hashMix(std::size_t hash) {
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	return hash ^ (hash >> 33);
+}
+
+inline
+std::size_t hashValue(const Label& label) {
+	std::size_t seed = label.size();
+	for (const LabelString& str : label) {
+		seed = hashCombine(seed, std::hash<const std::string*>()(&str.str()));
+	}
+	return seed;
+}
+
+inline
+std::size_t hashValue(const Multiset& multiset) {
+	std::size_t seed = multiset.size();
+	for (auto it = multiset.begin(); it != multiset.end(); ++it) {
+		seed = hashCombine(seed, std::hash<const std::string*>()(&it->first.str()));
+		seed = hashCombine(seed, it->second.raw());
+	}
+	return seed;
+}
+
+inline
+std::size_t hashValue(const IMembrane& membrane) {
+	return hashCombine(hashCombine(hashValue(membrane.label), membrane.charge), hashValue(membrane.multiset));
+}
+
+inline
+std::size_t hashValue(const OMembrane& membrane) {
+	std::size_t children = membrane.data.size();
+	for (const IMembrane& child : membrane.data) {
+		children += hashMix(hashValue(child));
+	}
+	return hashCombine(hashValue((const IMembrane&)membrane), children);
+}
+
+inline
+std::size_t hashValue(const Rule& rule) {
+	std::size_t seed = hashCombine(rule.arrow, hashValue(rule.lhr.multiset));
+	seed = hashCombine(seed, hashValue(rule.lhr.membrane));
+	seed = hashCombine(seed, hashValue(rule.rhr.multiset));
+	std::size_t membranes = rule.rhr.data.size();
+	for (const OMembrane& membrane : rule.rhr.data) {
+		membranes += hashMix(hashValue(membrane));
+	}
+	return hashCombine(seed, membranes);
+}
+
+
+inline
+bool RuleSet::insert(const Rule& rule) {
+	std::size_t hash = hashValue(rule);
+	if (find(rule, hash) >= 0) {
+		return false;
+	}
+	unsigned i = rules.size();
+	rules.push_back(rule);
+	hashes.push_back(hash);
+	index.emplace(hash, i);
+	// rules inserted in order, like the ones loaded from a file, do not need to be sorted
+	if (sorted && !order.empty() && !(rules[order.back()] < rule)) {
+		sorted = false;
+	}
+	order.push_back(i);
+	return true;
+}
+
+inline
+void RuleSet::clear() {
+	rules.clear();
+	hashes.clear();
+	index.clear();
+	order.clear();
+	sorted = true;
+}
+
+inline
+long RuleSet::find(const Rule& rule, std::size_t hash) const {
+	auto range = index.equal_range(hash);
+	for (auto it = range.first; it != range.second; ++it) {
+		if (rules[it->second] == rule) {
+			return it->second;
+		}
+	}
+	return -1;
+}
+
+inline
+void RuleSet::sort() const {
+	if (sorted) {
+		return;
+	}
+	std::sort(order.begin(), order.end(), [this](unsigned a, unsigned b) {return rules[a] < rules[b];});
+	sorted = true;
+}
+
+template<class P>
+void RuleSet::removeIf(P remove) {
+	sort();
+	std::deque<Rule> kept;
+	std::vector<std::size_t> keptHashes;
+	for (unsigned i : order) {
+		if (!remove(rules[i])) {
+			kept.push_back(std::move(rules[i]));
+			keptHashes.push_back(hashes[i]);
+		}
+	}
+	rules.swap(kept);
+	hashes.swap(keptHashes);
+	index.clear();
+	order.resize(rules.size());
+	for (unsigned i = 0; i < rules.size(); i++) {
+		index.emplace(hashes[i], i);
+		order[i] = i;
+	}
+}
+
+// same format as std::set
+template<class A>
+void RuleSet::save(A& archive) const {
+	archive(cereal::make_size_tag(static_cast<cereal::size_type>(size())));
+	for (const Rule& rule : *this) {
+		archive(rule);
+	}
+}
+
+template<class A>
+void RuleSet::load(A& archive) {
+	cereal::size_type n;
+	archive(cereal::make_size_tag(n));
+	clear();
+	for (cereal::size_type i = 0; i < n; i++) {
+		Rule rule;
+		archive(rule);
+		insert(rule);
+	}
+}
+
+
+// SHAPES OF THE RULES
+// The integers of an object are the components of its indexes written as numbers, like 3 in a{3,b}.
+// The shape of a rule keeps everything but its integers, and the order of its integers does not
+// depend on them: the objects of a multiset are sorted by their shapes and then by their integers.
+
+const char INTEGER_MARK = '\1';
+
+// true if str[begin,end) is a number written as std::to_string writes it
+inline
+bool isCanonicalInteger(const std::string& str, std::size_t begin, std::size_t end) {
+	if (begin < end && str[begin] == '-') {
+		begin++;
+		if (begin < end && str[begin] == '0') {
+			return false;
+		}
+	}
+	if (begin == end || end - begin > 18 || (str[begin] == '0' && end - begin > 1)) {
+		return false;
+	}
+	for (std::size_t i = begin; i < end; i++) {
+		if (!isdigit((unsigned char)str[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+inline
+void splitName(const std::string& name, std::string& shape, std::vector<long>& integers) {
+	std::size_t i = 0;
+	while (i < name.size()) {
+		char c = name[i++];
+		shape += c;
+		if (c == '{' || c == ',') {
+			std::size_t end = i;
+			while (end < name.size() && name[end] != ',' && name[end] != '}' && name[end] != '{') {
+				end++;
+			}
+			if (end < name.size() && name[end] != '{' && isCanonicalInteger(name, i, end)) {
+				integers.push_back(std::stol(name.substr(i, end - i)));
+				shape += INTEGER_MARK;
+				i = end;
+			}
+		}
+	}
+}
+
+inline
+std::string joinName(const std::string& shape, const std::vector<long>& integers, std::size_t& position) {
+	std::string name;
+	for (char c : shape) {
+		if (c == INTEGER_MARK) {
+			name += std::to_string(integers[position++]);
+		} else {
+			name += c;
+		}
+	}
+	return name;
+}
+
+// texts are written with their lengths, so shapes of different rules are different
+inline
+void appendText(std::string& shape, const std::string& text) {
+	shape += std::to_string(text.size());
+	shape += ':';
+	shape += text;
+}
+
+struct ShapeEntry {
+	std::string shape;
+	std::vector<long> integers;
+	long multiplicity;
+	bool operator<(const ShapeEntry& other) const {
+		return shape < other.shape || (shape == other.shape && integers < other.integers);
+	}
+};
+
+inline
+void getShapeEntries(const Multiset& multiset, std::vector<ShapeEntry>& entries) {
+	entries.resize(multiset.size());
+	unsigned i = 0;
+	for (auto it = multiset.begin(); it != multiset.end(); ++it) {
+		ShapeEntry& entry = entries[i++];
+		splitName(it->first.str(), entry.shape, entry.integers);
+		entry.multiplicity = it->second.raw();
+	}
+	std::sort(entries.begin(), entries.end());
+}
+
+inline
+void getMultisetShape(const Multiset& multiset, std::string& shape, std::vector<long>& integers) {
+	std::vector<ShapeEntry> entries;
+	getShapeEntries(multiset, entries);
+	shape += std::to_string(entries.size());
+	shape += '[';
+	for (const ShapeEntry& entry : entries) {
+		appendText(shape, entry.shape);
+		integers.insert(integers.end(), entry.integers.begin(), entry.integers.end());
+		integers.push_back(entry.multiplicity);
+	}
+}
+
+inline
+void getLabelShape(const Label& label, std::string& shape, std::vector<long>& integers) {
+	shape += std::to_string(label.size());
+	shape += '\'';
+	for (const LabelString& str : label) {
+		if (isCanonicalInteger(str.str(), 0, str.str().size())) {
+			shape += INTEGER_MARK;
+			integers.push_back(std::stol(str.str()));
+		} else {
+			appendText(shape, str.str());
+		}
+	}
+}
+
+inline
+void getMembraneShape(const IMembrane& membrane, std::string& shape, std::vector<long>& integers) {
+	shape += membrane.charge;
+	getLabelShape(membrane.label, shape, integers);
+	getMultisetShape(membrane.multiset, shape, integers);
+}
+
+inline
+void getMembraneShape(const OMembrane& membrane, std::string& shape, std::vector<long>& integers) {
+	getMembraneShape(static_cast<const IMembrane&>(membrane), shape, integers);
+	shape += std::to_string(membrane.data.size());
+	shape += '(';
+	for (const IMembrane& child : membrane.data) {
+		getMembraneShape(child, shape, integers);
+	}
+}
+
+inline
+void setMultisetIntegers(const Multiset& pattern, const std::vector<long>& integers, std::size_t& position, Multiset& multiset) {
+	std::vector<ShapeEntry> entries;
+	getShapeEntries(pattern, entries);
+	multiset.clear();
+	for (const ShapeEntry& entry : entries) {
+		ObjectString object(joinName(entry.shape, integers, position));
+		multiset[object] = Multiplicity(integers[position++]);
+	}
+}
+
+inline
+void setLabelIntegers(const Label& pattern, const std::vector<long>& integers, std::size_t& position, Label& label) {
+	label.clear();
+	for (const LabelString& str : pattern) {
+		if (isCanonicalInteger(str.str(), 0, str.str().size())) {
+			label.push_back(LabelString(std::to_string(integers[position++])));
+		} else {
+			label.push_back(str);
+		}
+	}
+}
+
+inline
+void setMembraneIntegers(const IMembrane& pattern, const std::vector<long>& integers, std::size_t& position, IMembrane& membrane) {
+	membrane.charge = pattern.charge;
+	setLabelIntegers(pattern.label, integers, position, membrane.label);
+	setMultisetIntegers(pattern.multiset, integers, position, membrane.multiset);
+}
+
+inline
+void setMembraneIntegers(const OMembrane& pattern, const std::vector<long>& integers, std::size_t& position, OMembrane& membrane) {
+	setMembraneIntegers(static_cast<const IMembrane&>(pattern), integers, position, static_cast<IMembrane&>(membrane));
+	membrane.data.resize(pattern.data.size());
+	for (unsigned i = 0; i < pattern.data.size(); i++) {
+		setMembraneIntegers(pattern.data[i], integers, position, membrane.data[i]);
+	}
+}
+
+inline
+bool equalValues(const Value& a, const Value& b) {
+	if (a.type() != b.type()) {
+		return false;
+	}
+	switch (a.type()) {
+		case Value::STRING: return strcmp(a.as_string(), b.as_string()) == 0;
+		case Value::DOUBLE: return a.as_double() == b.as_double();
+		default:            return a.cast_long() == b.cast_long();
+	}
+}
+
+
+inline
+void RuleFamily::getShape(const Rule& rule, std::string& shape, std::vector<long>& integers) {
+	shape += '0' + rule.arrow;
+	getMultisetShape(rule.lhr.multiset, shape, integers);
+	getMembraneShape(rule.lhr.membrane, shape, integers);
+	getMultisetShape(rule.rhr.multiset, shape, integers);
+	shape += std::to_string(rule.rhr.data.size());
+	shape += '(';
+	for (const OMembrane& membrane : rule.rhr.data) {
+		getMembraneShape(membrane, shape, integers);
+	}
+	shape += std::to_string(rule.features.size());
+	shape += '@';
+	for (auto it = rule.features.begin(); it != rule.features.end(); ++it) {
+		appendText(shape, it->first.str());
+		shape += '0' + it->second.type();
+	}
+}
+
+inline
+void RuleFamily::setIntegers(const Rule& pattern, const std::vector<long>& integers, Rule& rule) {
+	std::size_t position = 0;
+	rule.arrow = pattern.arrow;
+	setMultisetIntegers(pattern.lhr.multiset, integers, position, rule.lhr.multiset);
+	setMembraneIntegers(pattern.lhr.membrane, integers, position, rule.lhr.membrane);
+	setMultisetIntegers(pattern.rhr.multiset, integers, position, rule.rhr.multiset);
+	rule.rhr.data.resize(pattern.rhr.data.size());
+	for (unsigned i = 0; i < pattern.rhr.data.size(); i++) {
+		setMembraneIntegers(pattern.rhr.data[i], integers, position, rule.rhr.data[i]);
+	}
+	rule.features = pattern.features;
+}
+
+// rules of a source with the same shape
+struct RuleFamily::Group {
+	Rule pattern;
+	unsigned width;             // integers of every rule
+	unsigned rows;
+	std::vector<long> integers; // integers of the rules, row by row
+	std::vector<Value> values;  // values of the features, row by row
+	long get(unsigned row, unsigned column) const {return integers[(std::size_t)row * width + column];}
+};
+
+inline
+std::size_t RuleFamily::size() const {
+	if (!points.empty()) {
+		return points.size() / lower.size();
+	}
+	std::size_t size = 1;
+	for (unsigned i = 0; i < lower.size(); i++) {
+		size *= upper[i] - lower[i] + 1;
+	}
+	return size;
+}
+
+template<class F>
+void RuleFamily::forEach(F f) const {
+	std::string shape;
+	std::vector<long> base;
+	getShape(rule, shape, base);
+	unsigned k = lower.size();
+	std::size_t count = size();
+	// rule is the first instance
+	std::vector<long> origin(lower);
+	if (!points.empty()) {
+		origin.assign(points.begin(), points.begin() + k);
+	}
+	std::vector<long> parameters(origin);
+	std::vector<long> integers;
+	for (std::size_t i = 0; i < count; i++) {
+		if (!points.empty()) {
+			parameters.assign(points.begin() + i * k, points.begin() + (i + 1) * k);
+		}
+		integers = base;
+		for (unsigned j = 0; j < columns.size(); j++) {
+			for (unsigned p = 0; p < k; p++) {
+				integers[columns[j]] += coefficients[j * k + p] * (parameters[p] - origin[p]);
+			}
+		}
+		Rule instance;
+		setIntegers(rule, integers, instance);
+		for (unsigned v = 0; v < variables.size(); v++) {
+			instance.features[variables[v]] = values[i * variables.size() + v];
+		}
+		f(instance);
+		for (unsigned p = k; points.empty() && p-- > 0;) {
+			if (++parameters[p] <= upper[p]) {
+				break;
+			}
+			parameters[p] = lower[p];
+		}
+	}
+}
+
+template<class S>
+void RuleFamily::pack(const S& source, RuleSet& rules, std::vector<RuleFamily>& families) {
+	std::unordered_map<std::string, unsigned> shapes;
+	std::deque<Group> groups;
+	std::string shape;
+	std::vector<long> integers;
+	source.forEach([&](const Rule& rule) {
+		shape.clear();
+		integers.clear();
+		getShape(rule, shape, integers);
+		auto it = shapes.emplace(shape, groups.size());
+		if (it.second) {
+			groups.emplace_back();
+			groups.back().pattern = rule;
+			groups.back().width = integers.size();
+			groups.back().rows = 0;
+		}
+		Group& group = groups[it.first->second];
+		group.integers.insert(group.integers.end(), integers.begin(), integers.end());
+		for (auto feature = rule.features.begin(); feature != rule.features.end(); ++feature) {
+			group.values.push_back(feature->second);
+		}
+		group.rows++;
+	});
+	for (const Group& group : groups) {
+		pack(group, rules, families);
+	}
+}
+
+inline
+void RuleFamily::pack(const Group& group, RuleSet& rules, std::vector<RuleFamily>& families) {
+	// the integers which are not affine functions of the parameters are new parameters
+	std::vector<unsigned> parameters;
+	std::vector<unsigned> basis;
+	std::vector<unsigned> columns;
+	std::vector<std::vector<long>> fitted;
+	for (unsigned column = 0; column < group.width && group.rows > 1; column++) {
+		bool constant = true;
+		for (unsigned i = 1; i < group.rows && constant; i++) {
+			constant = group.get(i, column) == group.get(0, column);
+		}
+		if (constant) {
+			continue;
+		}
+		std::vector<long> aux;
+		if (!fit(group, parameters, basis, column, aux)) {
+			parameters.push_back(column);
+			getBasis(group, parameters, basis);
+			aux.assign(parameters.size(), 0);
+			aux.back() = 1;
+		}
+		columns.push_back(column);
+		fitted.push_back(aux);
+	}
+	unsigned k = parameters.size();
+	if (k == 0) {
+		for (unsigned row = 0; row < group.rows; row++) {
+			Rule rule;
+			getInstance(group, row, rule);
+			rules.insert(rule);
+		}
+		return;
+	}
+
+	// the parameters of the instances are a box or they are kept for every instance
+	RuleFamily family;
+	std::vector<unsigned> instances; // row of every instance
+	if (!getBox(group, parameters, family, instances)) {
+		instances.resize(group.rows);
+		for (unsigned row = 0; row < group.rows; row++) {
+			instances[row] = row;
+			for (unsigned column : parameters) {
+				family.points.push_back(group.get(row, column));
+			}
+		}
+	}
+	getInstance(group, instances[0], family.rule);
+	family.columns = columns;
+	for (std::vector<long>& aux : fitted) {
+		aux.resize(k, 0);
+		family.coefficients.insert(family.coefficients.end(), aux.begin(), aux.end());
+	}
+	// the values of the features which change are kept for every instance
+	unsigned features = group.pattern.features.size();
+	std::vector<unsigned> variables;
+	auto feature = group.pattern.features.begin();
+	for (unsigned f = 0; f < features; f++, ++feature) {
+		const Value& first = group.values[(std::size_t)instances[0] * features + f];
+		for (unsigned row : instances) {
+			if (!equalValues(first, group.values[(std::size_t)row * features + f])) {
+				variables.push_back(f);
+				family.variables.push_back(feature->first);
+				break;
+			}
+		}
+	}
+	if (!variables.empty()) {
+		for (unsigned row : instances) {
+			for (unsigned f : variables) {
+				family.values.push_back(group.values[(std::size_t)row * features + f]);
+			}
+		}
+	}
+	families.push_back(std::move(family));
+}
+
+// true if the parameters take every value of a box once, instances are the rows in the order
+// of the box, lower and upper are the bounds of the parameters anyway
+inline
+bool RuleFamily::getBox(const Group& group, const std::vector<unsigned>& parameters, RuleFamily& family, std::vector<unsigned>& instances) {
+	unsigned k = parameters.size();
+	family.lower.resize(k);
+	family.upper.resize(k);
+	bool box = true;
+	std::size_t size = 1;
+	for (unsigned p = 0; p < k; p++) {
+		long lower = group.get(0, parameters[p]);
+		long upper = lower;
+		for (unsigned row = 0; row < group.rows; row++) {
+			lower = std::min(lower, group.get(row, parameters[p]));
+			upper = std::max(upper, group.get(row, parameters[p]));
+		}
+		family.lower[p] = lower;
+		family.upper[p] = upper;
+		if (!box || (unsigned long)(upper - lower) >= group.rows || size * (upper - lower + 1) > group.rows) {
+			box = false;
+		} else {
+			size *= upper - lower + 1;
+		}
+	}
+	if (!box || size != group.rows) {
+		return false;
+	}
+	instances.assign(size, group.rows);
+	for (unsigned row = 0; row < group.rows; row++) {
+		std::size_t index = 0;
+		for (unsigned p = 0; p < k; p++) {
+			index = index * (family.upper[p] - family.lower[p] + 1) + (group.get(row, parameters[p]) - family.lower[p]);
+		}
+		if (instances[index] != group.rows) {
+			return false;
+		}
+		instances[index] = row;
+	}
+	return true;
+}
+
+// rows whose parameters, minus the ones of the first row, are linearly independent
+inline
+void RuleFamily::getBasis(const Group& group, const std::vector<unsigned>& parameters, std::vector<unsigned>& basis) {
+	unsigned k = parameters.size();
+	basis.assign(1, 0);
+	std::vector<std::vector<double>> reduced;
+	std::vector<unsigned> pivots;
+	std::vector<double> v(k);
+	for (unsigned i = 1; i < group.rows && basis.size() <= k; i++) {
+		for (unsigned p = 0; p < k; p++) {
+			v[p] = group.get(i, parameters[p]) - group.get(0, parameters[p]);
+		}
+		for (unsigned j = 0; j < reduced.size(); j++) {
+			double factor = v[pivots[j]] / reduced[j][pivots[j]];
+			for (unsigned p = 0; p < k; p++) {
+				v[p] -= factor * reduced[j][p];
+			}
+		}
+		unsigned pivot = 0;
+		for (unsigned p = 1; p < k; p++) {
+			if (fabs(v[p]) > fabs(v[pivot])) {
+				pivot = p;
+			}
+		}
+		if (fabs(v[pivot]) > 1e-9) {
+			reduced.push_back(v);
+			pivots.push_back(pivot);
+			basis.push_back(i);
+		}
+	}
+}
+
+// integer coefficients of the parameters which give the column in every row
+inline
+bool RuleFamily::fit(const Group& group, const std::vector<unsigned>& parameters, const std::vector<unsigned>& basis, unsigned column, std::vector<long>& coefficients) {
+	unsigned k = parameters.size();
+	if (k == 0 || basis.size() != k + 1) {
+		return false;
+	}
+	// solve the system of the rows of the basis
+	std::vector<std::vector<double>> m(k, std::vector<double>(k + 1));
+	for (unsigned j = 0; j < k; j++) {
+		for (unsigned p = 0; p < k; p++) {
+			m[j][p] = group.get(basis[j + 1], parameters[p]) - group.get(basis[0], parameters[p]);
+		}
+		m[j][k] = group.get(basis[j + 1], column) - group.get(basis[0], column);
+	}
+	for (unsigned p = 0; p < k; p++) {
+		unsigned pivot = p;
+		for (unsigned j = p + 1; j < k; j++) {
+			if (fabs(m[j][p]) > fabs(m[pivot][p])) {
+				pivot = j;
+			}
+		}
+		std::swap(m[p], m[pivot]);
+		if (fabs(m[p][p]) < 1e-9) {
+			return false;
+		}
+		for (unsigned j = 0; j < k; j++) {
+			if (j != p) {
+				double factor = m[j][p] / m[p][p];
+				for (unsigned q = p; q <= k; q++) {
+					m[j][q] -= factor * m[p][q];
+				}
+			}
+		}
+	}
+	coefficients.resize(k);
+	for (unsigned p = 0; p < k; p++) {
+		double x = m[p][k] / m[p][p];
+		if (fabs(x) > 1e12) {
+			return false;
+		}
+		coefficients[p] = llround(x);
+	}
+	// the coefficients have to be exact in every row
+	for (unsigned row = 0; row < group.rows; row++) {
+		long value = group.get(basis[0], column);
+		for (unsigned p = 0; p < k; p++) {
+			value += coefficients[p] * (group.get(row, parameters[p]) - group.get(basis[0], parameters[p]));
+		}
+		if (value != group.get(row, column)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+inline
+void RuleFamily::getInstance(const Group& group, unsigned row, Rule& rule) {
+	std::vector<long> integers(group.integers.begin() + (std::size_t)row * group.width, group.integers.begin() + (std::size_t)(row + 1) * group.width);
+	setIntegers(group.pattern, integers, rule);
+	unsigned features = rule.features.size();
+	unsigned f = 0;
+	for (auto it = rule.features.begin(); it != rule.features.end(); ++it) {
+		it->second = group.values[(std::size_t)row * features + f++];
+	}
+}
+
+template<class A>
+void RuleFamily::serialize(A& archive) {
+	archive(cereal::make_nvp("rule", rule),
+	        cereal::make_nvp("lower", lower),
+	        cereal::make_nvp("upper", upper),
+	        cereal::make_nvp("points", points),
+	        cereal::make_nvp("columns", columns),
+	        cereal::make_nvp("coefficients", coefficients),
+	        cereal::make_nvp("variables", variables),
+	        cereal::make_nvp("values", values));
+}
+
 
 inline
 void Alphabet::load(const Psystem& psystem)  {
+	load(psystem, psystem.rules);
+}
+
+template<class S>
+void Alphabet::load(const Psystem& psystem, const S& rules)  {
 	maxMultiplicity = 0;
 	addMembrane(psystem.structure);
 	for (auto it = psystem.multisets.begin(); it != psystem.multisets.end(); ++it) {
 		addLabel(it->first);
 		addMultiset(it->second);
 	}	
-	for (auto it = psystem.rules.begin(); it != psystem.rules.end(); ++it) {
-		addRule(*it);
-	}
+	rules.forEach([this](const Rule& rule) {addRule(rule);});
 	for (auto it = psystem.features.begin(); it != psystem.features.end(); ++it) {
-		features[it->first.str()] = 0;
+		features[&it->first.str()] = 0;
 		if (it->second.type()==Value::Type::STRING) {
-			strings[it->second.as_string()] = 0;
+			strings[STRING_POOL.intern(it->second.as_string())] = 0;
 		}
 	}
 	if (!psystem.model.str().empty()) {
-		strings[psystem.model.str()] = 0;
+		strings[&psystem.model.str()] = 0;
 		std::set<String> aux;
 		psystem.semantics.getAllPatterns(aux);
 		for (auto it=aux.begin(); it!=aux.end();++it) {
-			strings[it->str()] = 0;
+			strings[&it->str()] = 0;
 		}
 	}
 	
@@ -685,7 +1422,7 @@ void Alphabet::load(const Psystem& psystem)  {
 inline
 void Alphabet::addMultiset(const Multiset& multiset) {
 	for (auto it = multiset.begin(); it!= multiset.end(); ++it) {
-		objects[it->first.str()] = 0;
+		objects[&it->first.str()] = 0;
 		if (it->second.raw() > maxMultiplicity) {
 			maxMultiplicity = it->second.raw();
 		}
@@ -695,7 +1432,7 @@ void Alphabet::addMultiset(const Multiset& multiset) {
 inline
 void Alphabet::addLabel(const Label& label) {
 	for (auto it = label.begin(); it != label.end(); ++it) {
-		labels[(*it).str()] = 0;
+		labels[&(*it).str()] = 0;
 	}
 }
 
@@ -727,79 +1464,73 @@ void Alphabet::addRule(const Rule& rule) {
 	}
 	addLabel(rule.lhr.membrane.label);
 	for (auto it = rule.features.begin(); it != rule.features.end(); ++it) {
-		features[it->first.str()] = 0;
+		features[&it->first.str()] = 0;
 		if (it->second.type()==Value::Type::STRING) {
-			strings[it->second.as_string()] = 0;
+			strings[STRING_POOL.intern(it->second.as_string())] = 0;
 		}
 	}
 }
 
+// ids in the order of the strings
 inline
-void Alphabet::sort() {
-	objects_array.clear();
-	std::size_t counter = 0;
-	for (auto it = objects.begin(); it!= objects.end(); ++it) {
-		objects_array.push_back(it->first);
-		it->second.set(counter++,objects.size());
-	}
-	labels_array.clear();
-	counter = 0;
-	for (auto it = labels.begin(); it!= labels.end(); ++it) {
-		labels_array.push_back(it->first);
-		it->second.set(counter++,labels.size());
+void sortIds(std::unordered_map<const std::string*,UId>& ids, std::vector<const std::string*>& array) {
+	array.clear();
+	array.reserve(ids.size());
+	for (auto it = ids.begin(); it != ids.end(); ++it) {
+		array.push_back(it->first);
 	}
-	features_array.clear();
-	counter = 0;
-	for (auto it = features.begin(); it!= features.end(); ++it) {
-		features_array.push_back(it->first);
-		it->second.set(counter++,features.size());
-	}
-	strings_array.clear();
-	counter = 0;
-	for (auto it = strings.begin(); it!= strings.end(); ++it) {
-		strings_array.push_back(it->first);
-		it->second.set(counter++,strings.size());
+	std::sort(array.begin(), array.end(), [](const std::string* a, const std::string* b) {return *a < *b;});
+	for (std::size_t i = 0; i < array.size(); i++) {
+		ids[array[i]].set(i,array.size());
 	}
 }
 
 inline
-const UId& Alphabet::getObjectId(const std::string& object) const {
-	return objects.at(object);
+void Alphabet::sort() {
+	sortIds(objects,objects_array);
+	sortIds(labels,labels_array);
+	sortIds(features,features_array);
+	sortIds(strings,strings_array);
 }
 
 inline
-const UId& Alphabet::getLabelId(const std::string& label) const {
-	return labels.at(label);
+const UId& Alphabet::getObjectId(const String& object) const {
+	return objects.at(&object.str());
 }
 
 inline
-const UId& Alphabet::getFeatureId(const std::string& feature) const {
-	return features.at(feature);
+const UId& Alphabet::getLabelId(const String& label) const {
+	return labels.at(&label.str());
 }
 
 inline
-const UId& Alphabet::getStringId(const std::string& str) const {
-	return strings.at(str);
+const UId& Alphabet::getFeatureId(const String& feature) const {
+	return features.at(&feature.str());
+}
+
+inline
+const UId& Alphabet::getStringId(const String& str) const {
+	return strings.at(&str.str());
 }
 
 inline
 const std::string& Alphabet::getObject(std::size_t id) const {
-	return objects_array[id];
+	return *objects_array[id];
 }
 
 inline
 const std::string& Alphabet::getLabel(std::size_t id) const {
-	return labels_array[id];
+	return *labels_array[id];
 }
 
 inline
 const std::string& Alphabet::getFeature(std::size_t id) const {
-	return features_array[id];
+	return *features_array[id];
 }
 
 inline
 const std::string& Alphabet::getString(std::size_t id) const {
-	return strings_array[id];
+	return *strings_array[id];
 }
 
 inline
@@ -829,39 +1560,49 @@ std::size_t Alphabet::getMaxMultiplicity() const {
 	return maxMultiplicity;
 }
 
+// copies of the strings of an alphabet
+inline
+std::vector<std::string> getStrings(const std::vector<const std::string*>& array) {
+	std::vector<std::string> strings;
+	strings.reserve(array.size());
+	for (const std::string* str : array) {
+		strings.push_back(*str);
+	}
+	return strings;
+}
+
+// interned strings of an alphabet and their ids
+inline
+void setStrings(const std::vector<std::string>& strings, std::unordered_map<const std::string*,UId>& ids, std::vector<const std::string*>& array) {
+	ids.clear();
+	array.clear();
+	for (unsigned i = 0; i< strings.size(); i++) {
+		array.push_back(STRING_POOL.intern(strings[i]));
+		ids[array.back()].set(i,strings.size());
+	}
+}
+
 template<class A> 
 void Alphabet::save(A& archive) const {
-	archive(cereal::make_nvp("objects", objects_array),
-	         cereal::make_nvp("labels", labels_array),
-	         cereal::make_nvp("features", features_array),
-	         cereal::make_nvp("strings", strings_array),
+	archive(cereal::make_nvp("objects", getStrings(objects_array)),
+	         cereal::make_nvp("labels", getStrings(labels_array)),
+	         cereal::make_nvp("features", getStrings(features_array)),
+	         cereal::make_nvp("strings", getStrings(strings_array)),
 	         cereal::make_nvp("max_multiplicity", maxMultiplicity));
 }
 
 template<class A> 
 void Alphabet::load(A& archive) {
-	archive(cereal::make_nvp("objects", objects_array),
-	         cereal::make_nvp("labels", labels_array),
-	         cereal::make_nvp("features", features_array),
-	         cereal::make_nvp("strings", strings_array),
+	std::vector<std::string> objects_strings, labels_strings, features_strings, strings_strings;
+	archive(cereal::make_nvp("objects", objects_strings),
+	         cereal::make_nvp("labels", labels_strings),
+	         cereal::make_nvp("features", features_strings),
+	         cereal::make_nvp("strings", strings_strings),
 	         cereal::make_nvp("max_multiplicity", maxMultiplicity));
-	
-	objects.clear();
-	labels.clear();
-	features.clear();
-	strings.clear();
-	for (unsigned i = 0; i< objects_array.size(); i++) {
-		objects[objects_array[i]].set(i,objects_array.size());
-	}         
-	for (unsigned i = 0; i< labels_array.size(); i++) {
-		labels[labels_array[i]].set(i,labels_array.size());
-	}  
-	for (unsigned i = 0; i< features_array.size(); i++) {
-		features[features_array[i]].set(i,features_array.size());
-	}    
-	for (unsigned i = 0; i< strings_array.size(); i++) {
-		strings[strings_array[i]].set(i,strings_array.size());
-	}    
+	setStrings(objects_strings,objects,objects_array);
+	setStrings(labels_strings,labels,labels_array);
+	setStrings(features_strings,features,features_array);
+	setStrings(strings_strings,strings,strings_array);
 }
 
 template<class A>
@@ -875,33 +1616,76 @@ void Semantics::serialize(A& archive) {
 
 template<class A>
 void Psystem::save(A& archive) const {
-	ALPHABET.load(*this);
+	saveWith(archive, rules, false);
+}
+
+template<class A>
+void Psystem::load(A& archive) {
+	loadWith(archive, false);
+}
+
+template<class A, class S>
+void Psystem::saveWith(A& archive, const S& source, bool families) const {
+	ALPHABET.load(*this, source);
 	ALPHABET.save(archive);
 	archive(cereal::make_nvp("model", model));
 	archive(cereal::make_nvp("semantics", semantics));
 	archive(cereal::make_nvp("structure", structure));
 	archive(cereal::make_nvp("multisets", multisets));
-	archive(cereal::make_nvp("rules",rules));
+	if (families) {
+		RuleSet alone;
+		std::vector<RuleFamily> packed;
+		RuleFamily::pack(source, alone, packed);
+		archive(cereal::make_nvp("rules",alone));
+		archive(cereal::make_nvp("families",packed));
+	} else {
+		archive(cereal::make_nvp("rules",RuleWriter<S>(source)));
+	}
 	archive(cereal::make_nvp("features",features));
 }
 
-
 template<class A>
-void Psystem::load(A& archive) {
+void Psystem::loadWith(A& archive, bool families) {
 	ALPHABET.load(archive);
 	archive(cereal::make_nvp("model",model));
 	archive(cereal::make_nvp("semantics", semantics));
 	archive(cereal::make_nvp("structure", structure));
 	archive(cereal::make_nvp("multisets", multisets));
 	archive(cereal::make_nvp("rules",rules));
+	if (families) {
+		std::vector<RuleFamily> packed;
+		archive(cereal::make_nvp("families",packed));
+		for (const RuleFamily& family : packed) {
+			family.forEach([this](const Rule& rule) {rules.insert(rule);});
+		}
+	}
 	archive(cereal::make_nvp("features",features));
 }
 
+template<class S> template<class A>
+void RuleWriter<S>::save(A& archive) const {
+	archive(cereal::make_size_tag(static_cast<cereal::size_type>(source.size())));
+	source.forEach([&archive](const Rule& rule) {archive(rule);});
+}
+
+
+template<class A> 
+void File::save(A& archive) const {
+	StreamedFile<RuleSet>(*this, psystem.rules).save(archive);
+}
+
 template<class A> 
-void File::serialize(A& archive) {
+void File::load(A& archive) {
 	archive(cereal::make_nvp("header", header),
-		    cereal::make_nvp("version", version),
-			cereal::make_nvp("psystem", psystem));
+		    cereal::make_nvp("version", version));
+	archive(cereal::make_nvp("psystem", PsystemLoader{psystem, version == FAMILIES_FILE_VERSION}));
+}
+
+template<class S> template<class A>
+void StreamedFile<S>::save(A& archive) const {
+	archive(cereal::make_nvp("header", file.header),
+		    cereal::make_nvp("version", file.version),
+			cereal::make_nvp("psystem", StreamedPsystem{file.psystem, source, file.version == FAMILIES_FILE_VERSION}));
 }
 
 template<class T>
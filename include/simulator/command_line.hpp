@@ -2,6 +2,7 @@
 #define _COMMAND_LINE_HPP_
 
 #include <string>
+#include <vector>
 
 namespace plingua { namespace simulator {
 
@@ -18,9 +19,27 @@ public:
 	unsigned getMaxStepsToSimulate() const {return steps;}
 			
 	const std::string& getInputFile() const {return inputFile;}
+	const std::vector<std::string>& getIncludePaths() const {return includePaths;}
 	const std::string& getOutputFile() const {return outputFile;}
 	const std::string& getConfigurationFile() const {return configurationFile;}
 	bool isRandomized() const {return randomized;}
+	bool isPruning() const {return pruning;}
+	bool isMacroStepping() const {return macroStepping;}
+	bool isBinomialSelection() const {return binomialSelection;}
+	unsigned getMaxResidentMembranes() const {return residentMembranes;}
+	const std::string& getPageFile() const {return pageFile;}
+	const std::string& getStatsFile() const {return statsFile;}
+	const std::string& getProfileFile() const {return profileFile;}
+	bool isProfilingSteps() const {return profilingSteps;}
+	const std::string& getRuleProfileFile() const {return ruleProfileFile;}
+	bool isTimingRules() const {return timingRules;}
+	const std::string& getTraceFile() const {return traceFile;}
+	unsigned getMaxTraceEvents() const {return traceEvents;}
+	const std::string& getMemoryFile() const {return memoryFile;}
+	unsigned getMemorySteps() const {return memorySteps;}
+	const std::string& getLiveViewName() const {return liveViewName;}
+	bool isSeeded() const {return seeded;}
+	unsigned getSeed() const {return seed;}
 
 protected:
 	bool randomized;
@@ -29,12 +48,30 @@ private:
 	
 	void printAbout() const;
 	
+	bool pruning;
+	bool macroStepping;
+	bool binomialSelection;
+	bool profilingSteps;
+	bool timingRules;
 	int verbosityLevel;
 	unsigned steps;
+	unsigned residentMembranes;
+	unsigned traceEvents;
+	unsigned memorySteps;
+	bool seeded;
+	unsigned seed;
 				
 	std::string inputFile;
+	std::vector<std::string> includePaths;
 	std::string outputFile;
 	std::string configurationFile;
+	std::string pageFile;
+	std::string statsFile;
+	std::string profileFile;
+	std::string ruleProfileFile;
+	std::string traceFile;
+	std::string memoryFile;
+	std::string liveViewName;
 	
 };
 
@@ -0,0 +1,158 @@
+#ifndef _INSTRUMENTATION_HPP_
+#define _INSTRUMENTATION_HPP_
+
+#include <chrono>
+#include <ostream>
+
+namespace plingua { namespace simulator {
+
+// Phases of a simulation step, timed by Instrumentation.
+// Phases can be nested: getMaxApplications and consume run inside the
+// selection passes, and divisions inside the second execution pass.
+enum Phase {
+	SELECTION_PASSES,
+	MAX_APPLICATIONS,
+	CONSUMPTION,
+	EXECUTION_FIRST_PASS,
+	EXECUTION_SECOND_PASS,
+	DIVISION,
+	DISSOLUTION,
+	NUMBER_OF_PHASES
+};
+
+// Cumulative timers and counters of a simulation, they only cost
+// a branch when disabled
+class Instrumentation
+{
+public:
+	Instrumentation() : enabled(false) {clear();}
+
+	void clear();
+
+	// accumulate the timers and counters of other
+	void add(const Instrumentation& other);
+
+	// write the timers and counters as a JSON object
+	void write(std::ostream& os) const;
+
+	static const char* getPhaseName(Phase phase);
+
+	bool enabled;
+	double seconds[NUMBER_OF_PHASES];
+	std::size_t steps;
+	std::size_t passes;          // selection passes
+	std::size_t evaluatedRules;  // (membrane, rule) pairs evaluated by the selection
+	std::size_t appliedRules;    // (membrane, rule) pairs selected at least once
+};
+
+// Firing profile of a rule
+class RuleProfile
+{
+public:
+	RuleProfile() : evaluatedSteps(0), applicable(0), applications(0), seconds(0), lastStep(-1) {}
+
+	// count an evaluation of the rule in a given step
+	void evaluate(long step, std::size_t max)
+	{
+		if (step != lastStep) {
+			evaluatedSteps++;
+			lastStep = step;
+		}
+		if (max > 0) {
+			applicable++;
+		}
+	}
+
+	std::size_t evaluatedSteps;  // steps in which the rule was evaluated
+	std::size_t applicable;      // evaluations in which the rule could be applied
+	std::size_t applications;    // total applications
+	double seconds;              // time spent in getMaxApplications, if measured
+private:
+	long lastStep;
+};
+
+// Add the time of a scope to a phase
+class PhaseTimer
+{
+public:
+	PhaseTimer(Instrumentation& instrumentation, Phase phase)
+	: instrumentation(instrumentation), phase(phase)
+	{
+		if (instrumentation.enabled) {
+			start = std::chrono::steady_clock::now();
+		}
+	}
+
+	~PhaseTimer()
+	{
+		if (instrumentation.enabled) {
+			instrumentation.seconds[phase] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+	}
+
+	PhaseTimer(PhaseTimer const&) = delete;
+	void operator=(PhaseTimer const&) = delete;
+
+private:
+	Instrumentation& instrumentation;
+	Phase phase;
+	std::chrono::steady_clock::time_point start;
+};
+
+
+inline
+void Instrumentation::clear()
+{
+	for (unsigned i = 0; i < NUMBER_OF_PHASES; i++) {
+		seconds[i] = 0;
+	}
+	steps = 0;
+	passes = 0;
+	evaluatedRules = 0;
+	appliedRules = 0;
+}
+
+inline
+void Instrumentation::add(const Instrumentation& other)
+{
+	for (unsigned i = 0; i < NUMBER_OF_PHASES; i++) {
+		seconds[i] += other.seconds[i];
+	}
+	steps += other.steps;
+	passes += other.passes;
+	evaluatedRules += other.evaluatedRules;
+	appliedRules += other.appliedRules;
+}
+
+inline
+const char* Instrumentation::getPhaseName(Phase phase)
+{
+	switch (phase) {
+		case SELECTION_PASSES: return "selection_passes";
+		case MAX_APPLICATIONS: return "max_applications";
+		case CONSUMPTION: return "consumption";
+		case EXECUTION_FIRST_PASS: return "execution_first_pass";
+		case EXECUTION_SECOND_PASS: return "execution_second_pass";
+		case DIVISION: return "division";
+		case DISSOLUTION: return "dissolution";
+		default: return "";
+	}
+}
+
+inline
+void Instrumentation::write(std::ostream& os) const
+{
+	os << "{\"steps\": " << steps << ", \"passes\": " << passes
+		<< ", \"passes_per_step\": " << (steps > 0 ? (double)passes / steps : 0)
+		<< ", \"evaluated_rules\": " << evaluatedRules
+		<< ", \"applied_rules\": " << appliedRules
+		<< ", \"seconds\": {";
+	for (unsigned i = 0; i < NUMBER_OF_PHASES; i++) {
+		os << (i > 0 ? ", " : "") << "\"" << getPhaseName((Phase)i) << "\": " << seconds[i];
+	}
+	os << "}}";
+}
+
+}}
+
+#endif
@@ -0,0 +1,202 @@
+#ifndef _LIVE_VIEW_HPP_
+#define _LIVE_VIEW_HPP_
+
+#include <string>
+#include <cstring>
+#include <cstddef>
+#include <stdexcept>
+#include <cstdint>
+#include <atomic>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace plingua { namespace simulator {
+
+// Layout of the POSIX shared-memory segment published by psim --live.
+// The writer makes sequence odd before an update and even after it, so
+// readers copy the snapshot without locking and retry when sequence was
+// odd or changed during the copy (seqlock).
+struct LiveSnapshot
+{
+	static const uint32_t MAGIC = 0x4d495350; // "PSIM"
+	static const uint32_t VERSION = 1;
+	static const unsigned MAX_OBJECTS = 256;
+	static const unsigned NAME_SIZE = 32;
+
+	uint32_t magic;
+	uint32_t version;
+	int64_t pid;
+	std::atomic<uint64_t> sequence;
+
+	uint64_t time;               // current step
+	uint64_t finished;           // 1 when the simulation has halted
+	uint64_t membranes;          // resident membranes
+	uint64_t pagedMembranes;
+	uint64_t activeMembranes;
+	uint64_t applications;       // total rule applications
+	uint64_t totalObjects;       // objects in the resident membranes
+	double seconds;              // time since the simulation started
+	uint32_t objects;            // tracked objects
+	uint32_t untracked;          // distinct objects beyond MAX_OBJECTS
+	uint64_t counts[MAX_OBJECTS];
+	char names[MAX_OBJECTS][NAME_SIZE];
+};
+
+// Writer side of the live view, owns the segment
+class LiveView
+{
+public:
+	LiveView() : snapshot(NULL) {}
+	~LiveView() {close();}
+	LiveView(LiveView const&) = delete;
+	void operator=(LiveView const&) = delete;
+
+	// create the segment, the name must start with '/'
+	void open(const std::string& name);
+	void close();
+	bool isOpen() const {return snapshot != NULL;}
+
+	// the fields of the snapshot can only be written between begin() and end()
+	LiveSnapshot& begin();
+	void end();
+
+private:
+	std::string name;
+	LiveSnapshot* snapshot;
+};
+
+// Reader side of the live view
+class LiveViewReader
+{
+public:
+	LiveViewReader() : snapshot(NULL) {}
+	~LiveViewReader() {close();}
+	LiveViewReader(LiveViewReader const&) = delete;
+	void operator=(LiveViewReader const&) = delete;
+
+	void open(const std::string& name);
+	void close();
+
+	// copy a consistent snapshot, return false if the writer kept it busy for all the retries
+	bool read(LiveSnapshot& copy, unsigned retries = 1000) const;
+
+private:
+	const LiveSnapshot* snapshot;
+};
+
+
+inline
+void LiveView::open(const std::string& name)
+{
+	close();
+	int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd == -1) {
+		throw std::runtime_error("unable to create the shared memory segment " + name);
+	}
+	if (ftruncate(fd, sizeof(LiveSnapshot)) != 0) {
+		::close(fd);
+		shm_unlink(name.c_str());
+		throw std::runtime_error("unable to size the shared memory segment " + name);
+	}
+	void* address = mmap(NULL, sizeof(LiveSnapshot), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (address == MAP_FAILED) {
+		shm_unlink(name.c_str());
+		throw std::runtime_error("unable to map the shared memory segment " + name);
+	}
+	// the segment is zero-filled, so the sequence starts even
+	this->name = name;
+	snapshot = static_cast<LiveSnapshot*>(address);
+	snapshot->version = LiveSnapshot::VERSION;
+	snapshot->pid = getpid();
+	std::atomic_thread_fence(std::memory_order_release);
+	snapshot->magic = LiveSnapshot::MAGIC;
+}
+
+inline
+void LiveView::close()
+{
+	if (snapshot == NULL) {
+		return;
+	}
+	munmap(snapshot, sizeof(LiveSnapshot));
+	shm_unlink(name.c_str());
+	snapshot = NULL;
+}
+
+inline
+LiveSnapshot& LiveView::begin()
+{
+	snapshot->sequence.store(snapshot->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	return *snapshot;
+}
+
+inline
+void LiveView::end()
+{
+	snapshot->sequence.store(snapshot->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+inline
+void LiveViewReader::open(const std::string& name)
+{
+	close();
+	int fd = shm_open(name.c_str(), O_RDONLY, 0);
+	if (fd == -1) {
+		throw std::runtime_error("unable to open the shared memory segment " + name);
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0 || (std::size_t)info.st_size < sizeof(LiveSnapshot)) {
+		::close(fd);
+		throw std::runtime_error("the shared memory segment " + name + " is not a live view");
+	}
+	void* address = mmap(NULL, sizeof(LiveSnapshot), PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (address == MAP_FAILED) {
+		throw std::runtime_error("unable to map the shared memory segment " + name);
+	}
+	snapshot = static_cast<const LiveSnapshot*>(address);
+	if (snapshot->magic != LiveSnapshot::MAGIC || snapshot->version != LiveSnapshot::VERSION) {
+		close();
+		throw std::runtime_error("the shared memory segment " + name + " is not a live view");
+	}
+}
+
+inline
+void LiveViewReader::close()
+{
+	if (snapshot != NULL) {
+		munmap(const_cast<LiveSnapshot*>(snapshot), sizeof(LiveSnapshot));
+	}
+	snapshot = NULL;
+}
+
+inline
+bool LiveViewReader::read(LiveSnapshot& copy, unsigned retries) const
+{
+	for (unsigned i = 0; i < retries; i++) {
+		uint64_t before = snapshot->sequence.load(std::memory_order_acquire);
+		if (before % 2 == 0) {
+			// the fields after the sequence are plain data
+			const std::size_t header = offsetof(LiveSnapshot, time);
+			std::memcpy((char*)&copy + header, (const char*)snapshot + header, sizeof(LiveSnapshot) - header);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (snapshot->sequence.load(std::memory_order_relaxed) == before) {
+				copy.magic = snapshot->magic;
+				copy.version = snapshot->version;
+				copy.pid = snapshot->pid;
+				copy.sequence.store(before, std::memory_order_relaxed);
+				return true;
+			}
+		}
+		usleep(100);
+	}
+	return false;
+}
+
+}}
+
+#endif
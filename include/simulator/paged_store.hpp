@@ -0,0 +1,187 @@
+#ifndef _PAGED_STORE_HPP_
+#define _PAGED_STORE_HPP_
+
+#include <vector>
+#include <map>
+#include <string>
+#include <cstring>
+#include <stdexcept>
+#include <cstdint>
+#include <cstdlib>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <serialization.hpp>
+
+namespace plingua { namespace simulator {
+
+// Memory-mapped file holding the multisets of cold membranes.
+// Every multiset is stored in a slot of 2^k entries, freed slots are
+// reused by later multisets of the same size class.
+class PagedStore
+{
+public:
+	PagedStore() : fd(-1), data(NULL), capacity(0), top(0) {}
+	~PagedStore() {close();}
+	PagedStore(PagedStore const&) = delete;
+	void operator=(PagedStore const&) = delete;
+
+	// create the backing file, a temporary file is used if path is empty
+	void open(const std::string& path);
+	void close();
+	bool isOpen() const {return fd != -1;}
+
+	// store a multiset and return its offset in the file
+	std::size_t save(const Multiset& multiset);
+
+	// read the multiset stored at offset and release its slot
+	void load(std::size_t offset, Multiset& multiset);
+
+	std::size_t getMappedSize() const {return capacity;}
+
+private:
+	static const std::size_t HEADER_SIZE = 2 * sizeof(uint32_t);
+	static const std::size_t ENTRY_SIZE = sizeof(uint32_t) + sizeof(uint64_t);
+
+	void reserve(std::size_t bytes);
+	uint32_t getObjectId(const ObjectString& object);
+
+	int fd;
+	char* data;
+	std::size_t capacity;
+	std::size_t top;
+	std::map<unsigned, std::vector<std::size_t>> freeSlots; // free slots by size class
+	std::map<std::string, uint32_t> objectIds;
+	std::vector<ObjectString> objects;
+};
+
+
+inline
+void PagedStore::open(const std::string& path)
+{
+	close();
+	if (path.empty()) {
+		char name[] = "/tmp/psim-pages-XXXXXX";
+		fd = mkstemp(name);
+		if (fd != -1) {
+			unlink(name);
+		}
+	} else {
+		fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+	}
+	if (fd == -1) {
+		throw std::runtime_error("unable to create the page file " + path);
+	}
+}
+
+inline
+void PagedStore::close()
+{
+	if (data != NULL) {
+		munmap(data, capacity);
+	}
+	if (fd != -1) {
+		::close(fd);
+	}
+	fd = -1;
+	data = NULL;
+	capacity = 0;
+	top = 0;
+	freeSlots.clear();
+	objectIds.clear();
+	objects.clear();
+}
+
+inline
+void PagedStore::reserve(std::size_t bytes)
+{
+	if (bytes <= capacity) {
+		return;
+	}
+	std::size_t newCapacity = capacity == 0 ? 1 << 20 : capacity;
+	while (newCapacity < bytes) {
+		newCapacity *= 2;
+	}
+	if (data != NULL) {
+		munmap(data, capacity);
+		data = NULL;
+	}
+	if (ftruncate(fd, newCapacity) != 0) {
+		throw std::runtime_error("unable to grow the page file");
+	}
+	void* address = mmap(NULL, newCapacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (address == MAP_FAILED) {
+		throw std::runtime_error("unable to map the page file");
+	}
+	data = static_cast<char*>(address);
+	capacity = newCapacity;
+}
+
+inline
+uint32_t PagedStore::getObjectId(const ObjectString& object)
+{
+	auto it = objectIds.find(object.str());
+	if (it != objectIds.end()) {
+		return it->second;
+	}
+	uint32_t id = objects.size();
+	objectIds[object.str()] = id;
+	objects.push_back(object);
+	return id;
+}
+
+inline
+std::size_t PagedStore::save(const Multiset& multiset)
+{
+	unsigned sizeClass = 0;
+	while (((std::size_t)1 << sizeClass) < multiset.size()) {
+		sizeClass++;
+	}
+	std::size_t offset;
+	std::vector<std::size_t>& slots = freeSlots[sizeClass];
+	if (slots.empty()) {
+		offset = top;
+		top += HEADER_SIZE + ENTRY_SIZE * ((std::size_t)1 << sizeClass);
+		reserve(top);
+	} else {
+		offset = slots.back();
+		slots.pop_back();
+	}
+
+	uint32_t header[2] = {sizeClass, (uint32_t)multiset.size()};
+	char* p = data + offset;
+	memcpy(p, header, HEADER_SIZE);
+	p += HEADER_SIZE;
+	for (auto it = multiset.begin(); it != multiset.end(); ++it) {
+		uint32_t id = getObjectId(it->first);
+		uint64_t multiplicity = it->second.raw();
+		memcpy(p, &id, sizeof(id));
+		memcpy(p + sizeof(id), &multiplicity, sizeof(multiplicity));
+		p += ENTRY_SIZE;
+	}
+	return offset;
+}
+
+inline
+void PagedStore::load(std::size_t offset, Multiset& multiset)
+{
+	uint32_t header[2];
+	const char* p = data + offset;
+	memcpy(header, p, HEADER_SIZE);
+	p += HEADER_SIZE;
+	multiset.clear();
+	for (uint32_t i = 0; i < header[1]; i++) {
+		uint32_t id;
+		uint64_t multiplicity;
+		memcpy(&id, p, sizeof(id));
+		memcpy(&multiplicity, p + sizeof(id), sizeof(multiplicity));
+		// entries were saved in order
+		multiset.emplace_hint(multiset.end(), objects[id], Multiplicity(multiplicity));
+		p += ENTRY_SIZE;
+	}
+	freeSlots[header[0]].push_back(offset);
+}
+
+}}
+
+#endif
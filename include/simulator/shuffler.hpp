@@ -3,87 +3,117 @@
 
 
 #include <vector>
+#include <limits>
 #include <serialization.hpp>
 #include <random.hpp>
 
 namespace plingua { namespace simulator {
 
+// Scratch space reused by the shufflers across passes and steps
+class ShuffleBuffer
+{
+public:
+	std::vector<unsigned> indexes;
+	std::vector<uint32_t> words;      // random words drawn in bulk
+	std::vector<unsigned> positions;  // positions of the rules with priority
+	std::vector<unsigned> counts;     // counting sort by priority rank
+	std::vector<unsigned> sorted;
+};
+
+// Rank of the rules without priority
+const unsigned NO_PRIORITY = std::numeric_limits<unsigned>::max();
+
 template<class T>
 class Shuffler
 {
-public:	
-	Shuffler(std::vector<T>& data, bool randomized);
-	
+public:
+	// ranks: priority rank of every element (0 for the lowest priority value,
+	// NO_PRIORITY for elements without priority), empty if no element has priority.
+	// Elements with priority keep their random positions among them, but they are
+	// ordered by rank, elements with the same rank keep their random order.
+	Shuffler(std::vector<T>& data, bool randomized, RandomNumberGenerator& random, ShuffleBuffer& buffer,
+		const std::vector<unsigned>& ranks = std::vector<unsigned>());
+
 	const T& operator[](unsigned index) const;
 	T& operator[](unsigned index);
-	unsigned size() const {return randomized ? indexes.size() : data.size();}
-	
+	unsigned size() const {return data.size();}
+
 	unsigned operator()(unsigned index) const;
-	
-private:	
+
+private:
+	void sortByRank(const std::vector<unsigned>& ranks);
+
 	bool randomized;
 	std::vector<T>& data;
-	std::vector<unsigned> indexes;
+	std::vector<unsigned>& indexes;
+	ShuffleBuffer& buffer;
 };
 
 template<class T>
-Shuffler<T>::Shuffler(std::vector<T>& data, bool randomized)
+Shuffler<T>::Shuffler(std::vector<T>& data, bool randomized, RandomNumberGenerator& random, ShuffleBuffer& buffer, const std::vector<unsigned>& ranks)
 : randomized(randomized),
-  data(data)
+  data(data),
+  indexes(buffer.indexes),
+  buffer(buffer)
 {
 	if (!randomized) {
 		return;
 	}
 
-	for (unsigned i =0; i< data.size(); i++) {
-		indexes.push_back(i);
+	unsigned n = data.size();
+	indexes.resize(n);
+	for (unsigned i = 0; i < n; i++) {
+		indexes[i] = i;
 	}
-	
-	unsigned index, aux;
-	for (unsigned i=0;i<indexes.size()-1; i++) {
-		index = RANDOM(indexes.size() - i);
-		aux = indexes[index];
-		indexes[index] = indexes[indexes.size() - i - 1];
-		indexes[indexes.size() - i - 1] = aux;
+	if (n < 2) {
+		return;
 	}
-}
 
+	random.fill(buffer.words, n - 1);
+	for (unsigned i = 0; i + 1 < n; i++) {
+		unsigned index = RandomNumberGenerator::bound(buffer.words[i], n - i);
+		std::swap(indexes[index], indexes[n - i - 1]);
+	}
 
-template<>
-Shuffler<Rule>::Shuffler(std::vector<Rule>& data, bool randomized)
-: randomized(randomized),
-  data(data)
+	if (!ranks.empty()) {
+		sortByRank(ranks);
+	}
+}
+
+template<class T>
+void Shuffler<T>::sortByRank(const std::vector<unsigned>& ranks)
 {
-	if (!randomized) {
+	std::vector<unsigned>& positions = buffer.positions;
+	std::vector<unsigned>& counts = buffer.counts;
+	std::vector<unsigned>& sorted = buffer.sorted;
+
+	positions.clear();
+	unsigned maxRank = 0;
+	for (unsigned i = 0; i < indexes.size(); i++) {
+		unsigned rank = ranks[indexes[i]];
+		if (rank != NO_PRIORITY) {
+			positions.push_back(i);
+			maxRank = std::max(maxRank, rank);
+		}
+	}
+	if (positions.size() < 2) {
 		return;
 	}
 
-	for (unsigned i =0; i< data.size(); i++) {
-		indexes.push_back(i);
+	// stable counting sort of the rules with priority
+	counts.assign(maxRank + 2, 0);
+	for (unsigned p : positions) {
+		counts[ranks[indexes[p]] + 1]++;
 	}
-	
-	unsigned index, aux;
-	std::vector<unsigned> priority_indexes;
-	
-	for (unsigned i=0;i<indexes.size(); i++) {
-		index = RANDOM(indexes.size() - i);
-		aux = indexes[index];
-		indexes[index] = indexes[indexes.size() - i - 1];
-		indexes[indexes.size() - i - 1] = aux;
-		if (data[aux].features.count("priority")>0) {
-			priority_indexes.push_back(indexes.size() - i - 1);
-		}
+	for (unsigned r = 1; r < counts.size(); r++) {
+		counts[r] += counts[r - 1];
 	}
-	
-	for (unsigned i = 1 ; i< priority_indexes.size(); i++) {
-		for (unsigned j=0; j< priority_indexes.size()-i; j++) {
-			if (data[indexes[priority_indexes[j]]].features.at("priority").cast_long() <
-			     data[indexes[priority_indexes[j+1]]].features.at("priority").cast_long()) {
-				unsigned aux = indexes[priority_indexes[j+1]];
-				indexes[priority_indexes[j+1]] = indexes[priority_indexes[j]];
-				indexes[priority_indexes[j]] = aux;
-			}
-		}
+	sorted.resize(positions.size());
+	for (unsigned p : positions) {
+		sorted[counts[ranks[indexes[p]]]++] = indexes[p];
+	}
+	for (unsigned i = 0; i < positions.size(); i++) {
+		indexes[positions[i]] = sorted[i];
 	}
 }
 
@@ -6,9 +6,19 @@
 #include <map>
 #include <queue>
 #include <limits>
+#include <chrono>
+#include <fstream>
+#include <sys/resource.h>
 #include <simulator/command_line.hpp>
 #include <simulator/shuffler.hpp>
+#include <simulator/paged_store.hpp>
+#include <simulator/instrumentation.hpp>
+#include <simulator/live_view.hpp>
 #include <serialization.hpp>
+#include <parser/compiler.hpp>
+#include <reachability.hpp>
+#include <memory_accounting.hpp>
+#include <trace.hpp>
 
 
 namespace plingua { namespace simulator {
@@ -28,13 +38,16 @@ public:
 class Simulator : public CommandLine
 {
 public: 	
-	Simulator() : finished(false), initialTime(0) {}
+	Simulator() : environmentTouched(false), pagedMembranes(0), finished(false), initialTime(0), applications(0), liveTotalObjects(0), liveUntracked(0), liveEnvironmentDirty(false) {}
 	virtual ~Simulator() {}
 	void step();
 	virtual bool parse(int argc, char *argv[]);	
-	const Configuration& getCurrentConfiguration() const {return configuration;}
+	// paged membranes are brought back to memory
+	const Configuration& getCurrentConfiguration() {pageInAll(); return configuration;}
 	const File& getFile() const {return file;}
 	bool ok() const {return !finished;}
+	// approximate memory used by the simulator at the current step
+	void getMemoryReport(MemoryReport& report) const;
 	
 protected:
 	
@@ -52,6 +65,11 @@ private:
 	
 	std::size_t getMaxApplications(const Semantics& semantics, const std::string& pattern) const;
 	
+	// true if the pattern is found in the semantics and no node above it limits its applications,
+	// so the rules of the pattern are only limited by their objects
+	static bool isUnlimitedPattern(const Semantics& semantics, const std::string& pattern);
+	static bool isUnlimitedPattern(const Semantics& semantics, const std::string& pattern, bool& found);
+	
 	// count the times that ms0 is contained in ms1
 	static std::size_t count(const Multiset& ms0, const Multiset& ms1); 
 	
@@ -70,17 +88,133 @@ private:
 	void initConfigurationRec(const Membrane& membrane, int parent);
 	
 	unsigned copyMembrane(unsigned membraneId);
+	
+	// mark a membrane as modified in the current step
+	void touch(unsigned membraneId);
+	
+	// mark the environment as modified in the current step
+	void touchEnvironment();
+	
+	// move the touched membranes and the neighbours reading them to the worklist 
+	void wakeUp();
+	
+	// (region, object) pair, region is a membrane index or -1 for the environment
+	typedef std::pair<int, ObjectString> Place;
+	
+	// number of steps (>=1) in which the current selection will be repeated,
+	// delta is the change of the configuration caused by each of these steps
+	std::size_t getStableSteps(std::map<Place,long long>& delta);
+	
+	// apply the selected rules during several steps at once if the selection is stable
+	void macroStep();
+	
+	// index of the first child with a given label (and charge), -1 if not found 
+	int findChild(const CMembrane& m, unsigned labelId, const char* charge) const;
+	
+	// first membrane with a given label, -1 if not found
+	int findMembrane(unsigned labelId) const;
+	
+	// id of a label, new labels get the next free id
+	unsigned internLabel(const Label& label);
+	
+	// assign the label ids of all the membranes in a rule
+	void internLabels(Rule& rule);
+	
+	// rules for the label and charge of a membrane
+	unsigned getRuleIndex(const LeafMembrane& m) const {return m.labelId * 3 + (m.charge < 0 ? 0 : (m.charge == 0 ? 1 : 2));}
+	std::vector<Rule>& getRules(const LeafMembrane& m) {return ruleTable[getRuleIndex(m)];}
+	
+	std::size_t getMultiplicity(const Place& place);
+	
+	// bring the multiset of a paged membrane back to memory
+	void pageIn(unsigned membraneId);
+	
+	void pageInAll();
+	
+	// move the multisets of the least accessed inactive membranes to the page file
+	void pageOut();
+	
+	void pageOut(unsigned membraneId);
+	
+	std::size_t getResidentMembranes() const {return configuration.membranes.size() - freeIndexes.size() - pagedMembranes;}
 		
-	std::map<Label, std::map<char, std::vector<Rule>>> ruleSets;
+	std::map<Label, unsigned> labelIds;
+	std::vector<std::vector<Rule>> ruleTable; // rules by label id and charge (-, 0, +)
+	std::vector<std::vector<unsigned>> priorityRanks; // priority rank of every rule in ruleTable, empty without priorities
+	std::vector<bool> competingRules; // applicable rules at the beginning of a binomial selection
+	RandomNumberGenerator random; // stream of this run
+	ShuffleBuffer membraneBuffer;
+	ShuffleBuffer ruleBuffer;
+	mutable std::vector<int> firstMembranes;  // cache for findMembrane(), cleared when labels are copied
 	
 		
 	std::map<unsigned, std::map<unsigned,std::size_t>> selectedRules;	
-	std::queue<unsigned> freeIndexes;	
+	std::queue<unsigned> freeIndexes;
+	
+	// worklist of membranes which could have applicable rules, a membrane leaves it 
+	// when no rule can be applied and it is woken up again by touch()
+	std::set<unsigned> activeMembranes;
+	std::set<unsigned> touchedMembranes;
+	bool environmentTouched;
+	std::set<unsigned> rootMembranes; // membranes whose parent is the environment
+	std::vector<bool> pinnedLabels;   // labels with <--> rules, they depend on distant membranes 
+	std::vector<bool> outerReaders;   // labels with rules reading the parent multiset
+	std::vector<bool> innerReaders;   // labels with rules reading the child membranes
+	std::vector<unsigned> scheduledMembranes; // membranes considered by the last selection
+	PagedStore pagedStore;
+	std::vector<long long> pages;     // offset of each membrane in the page file, -1 if it is in memory
+	std::vector<unsigned> accesses;   // access frequency of each membrane, halved on every page out
+	std::size_t pagedMembranes;
+	std::vector<bool> exchangeTargets; // labels reached by <--> rules, they are never paged
 	Configuration configuration;
 	File file;
 	bool finished;
 	unsigned long initialTime;
 	
+	std::size_t applications; // rule applications since the beginning of the simulation
+	std::chrono::steady_clock::time_point startTime;
+	
+	// write the statistics of the simulation to getStatsFile() as JSON
+	void writeStatistics() const;
+	
+	// timers and counters of the current step when profiling per step, of the whole simulation otherwise
+	mutable Instrumentation instrumentation;
+	Instrumentation totalInstrumentation; // steps already written when profiling per step
+	std::ofstream profileStream;
+	
+	// write the timers and counters to getProfileFile() as JSON
+	void writeProfile();
+	
+	std::vector<std::vector<RuleProfile>> ruleProfiles; // by ruleTable entry, empty if not profiling rules
+	
+	// getMaxApplications() recording the profile of the rule
+	std::size_t getProfiledMaxApplications(const CMembrane& m, unsigned ruleIndex, unsigned rule);
+	
+	// write the rules ranked by applications to getRuleProfileFile()
+	void writeRuleProfile() const;
+	
+	std::ofstream memoryStream;
+	
+	LiveView liveView;
+	std::map<std::string, unsigned> liveObjects; // slot of every tracked object in the live view
+	std::vector<std::string> liveNames;
+	std::vector<uint64_t> liveTotals; // count of every tracked object
+	uint64_t liveTotalObjects;
+	unsigned liveUntracked;
+	std::vector<std::vector<std::pair<unsigned,uint64_t>>> liveCounts; // counts (slot, multiplicity) of each membrane in liveTotals
+	std::vector<std::pair<unsigned,uint64_t>> liveEnvironment;
+	std::vector<unsigned> liveDirty; // membranes changed since the last publication
+	bool liveEnvironmentDirty;
+	
+	// publish the counters and object counts of the current step to getLiveViewName()
+	void publishLiveView();
+	
+	// record a change in the multiset of a membrane for the live view, -1 for the environment
+	void markLiveChange(int membraneId);
+	
+	// replace the counts of a membrane (-1 for the environment) with the counts of its multiset
+	void updateLiveCounts(int membraneId, const Multiset& multiset);
+	
 };	
 
 ///////////////////////////////////////////////////////////
@@ -89,11 +223,246 @@ private:
 inline
 void Simulator::step()
 {
-	
-	selectRules();
-	executeRules();
+	TraceSpan span("step","psim");
+	unsigned long time = configuration.time;
+	{
+		TraceSpan span("selectRules","psim");
+		selectRules();
+	}
+	if (isMacroStepping()) {
+		TraceSpan span("macroStep","psim");
+		macroStep();
+	}
+	{
+		TraceSpan span("executeRules","psim");
+		executeRules();
+	}
 	finished = selectedRules.empty() || 
 				(getMaxStepsToSimulate()>0 && (configuration.time - initialTime) >= getMaxStepsToSimulate());
+	if (instrumentation.enabled) {
+		instrumentation.steps += configuration.time - time;
+		if (isProfilingSteps() || finished) {
+			writeProfile();
+		}
+	}
+	if (finished && !getStatsFile().empty()) {
+		writeStatistics();
+	}
+	if (finished && !ruleProfiles.empty()) {
+		writeRuleProfile();
+	}
+	// a macro-step may jump over several steps, so the report is written when
+	// the step crosses a multiple of the memory steps
+	if (memoryStream.is_open() && (finished || (getMemorySteps() > 0 &&
+			(time - initialTime) / getMemorySteps() < (configuration.time - initialTime) / getMemorySteps()))) {
+		MemoryReport report;
+		getMemoryReport(report);
+		memoryStream << "TIME: " << configuration.time << "\n" << report << std::endl;
+	}
+	if (liveView.isOpen()) {
+		publishLiveView();
+	}
+}
+
+inline
+void Simulator::publishLiveView()
+{
+	// only the membranes changed in this step are counted again, the membranes
+	// with selected rules are not marked by consume()
+	for (auto it = selectedRules.begin(); it != selectedRules.end(); ++it) {
+		liveDirty.push_back(it->first);
+	}
+	for (unsigned id : liveDirty) {
+		// paged membranes were counted when they left memory
+		if (id < pages.size() && pages[id] != -1) {
+			continue;
+		}
+		static const Multiset EMPTY;
+		const CMembrane& m = configuration.membranes[id];
+		updateLiveCounts(id, m.parent == -2 ? EMPTY : m.multiset);
+	}
+	liveDirty.clear();
+	if (liveEnvironmentDirty) {
+		updateLiveCounts(-1, configuration.environment);
+		liveEnvironmentDirty = false;
+	}
+	LiveSnapshot& snapshot = liveView.begin();
+	snapshot.time = configuration.time;
+	snapshot.finished = finished;
+	snapshot.membranes = getResidentMembranes();
+	snapshot.pagedMembranes = pagedMembranes;
+	snapshot.activeMembranes = activeMembranes.size();
+	snapshot.applications = applications;
+	snapshot.totalObjects = liveTotalObjects;
+	snapshot.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	for (unsigned i = snapshot.objects; i < liveNames.size(); i++) {
+		std::strncpy(snapshot.names[i], liveNames[i].c_str(), LiveSnapshot::NAME_SIZE - 1);
+	}
+	snapshot.objects = liveNames.size();
+	snapshot.untracked = liveUntracked;
+	std::copy(liveTotals.begin(), liveTotals.end(), snapshot.counts);
+	liveView.end();
+}
+
+inline
+void Simulator::updateLiveCounts(int membraneId, const Multiset& multiset)
+{
+	if (membraneId >= (int)liveCounts.size()) {
+		liveCounts.resize(configuration.membranes.size());
+	}
+	std::vector<std::pair<unsigned,uint64_t>>& counts = membraneId == -1 ? liveEnvironment : liveCounts[membraneId];
+	for (const std::pair<unsigned,uint64_t>& count : counts) {
+		if (count.first < LiveSnapshot::MAX_OBJECTS) {
+			liveTotals[count.first] -= count.second;
+		}
+		liveTotalObjects -= count.second;
+	}
+	counts.clear();
+	for (auto it = multiset.begin(); it != multiset.end(); ++it) {
+		auto slot = liveObjects.find(it->first.str());
+		if (slot == liveObjects.end()) {
+			unsigned index = LiveSnapshot::MAX_OBJECTS;
+			if (liveNames.size() < LiveSnapshot::MAX_OBJECTS) {
+				index = liveNames.size();
+				liveNames.push_back(it->first.str());
+			} else {
+				liveUntracked++;
+			}
+			slot = liveObjects.insert({it->first.str(), index}).first;
+		}
+		if (slot->second < LiveSnapshot::MAX_OBJECTS) {
+			liveTotals[slot->second] += it->second.raw();
+		}
+		liveTotalObjects += it->second.raw();
+		counts.push_back({slot->second, it->second.raw()});
+	}
+}
+
+inline
+void Simulator::getMemoryReport(MemoryReport& report) const
+{
+	memory::account(configuration, report);
+	report.add("paged multisets", pagedMembranes, pagedStore.getMappedSize());
+	memory::account("rule table", ruleTable, report);
+	memory::account("p system rules", file.psystem.rules, report);
+	memory::accountAlphabet(report);
+	std::size_t selected = 0;
+	for (auto it = selectedRules.begin(); it != selectedRules.end(); ++it) {
+		selected += it->second.size();
+	}
+	report.add("selected rules", selected, selectedRules.size() * memory::TREE_NODE_BYTES + selected * (memory::TREE_NODE_BYTES + 2 * sizeof(std::size_t)));
+	report.add("active membranes", activeMembranes.size(), activeMembranes.size() * (memory::TREE_NODE_BYTES + sizeof(unsigned)));
+	std::size_t profiles = 0;
+	for (const std::vector<RuleProfile>& rules : ruleProfiles) {
+		profiles += rules.size();
+	}
+	report.add("rule profiles", profiles, profiles * sizeof(RuleProfile));
+}
+
+inline
+std::size_t Simulator::getProfiledMaxApplications(const CMembrane& m, unsigned ruleIndex, unsigned rule)
+{
+	RuleProfile& profile = ruleProfiles[ruleIndex][rule];
+	std::size_t max;
+	if (isTimingRules()) {
+		auto start = std::chrono::steady_clock::now();
+		max = getMaxApplications(m,ruleTable[ruleIndex][rule]);
+		profile.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	} else {
+		max = getMaxApplications(m,ruleTable[ruleIndex][rule]);
+	}
+	profile.evaluate(configuration.time, max);
+	return max;
+}
+
+inline
+void Simulator::writeRuleProfile() const
+{
+	std::vector<std::pair<unsigned,unsigned>> rules;
+	for (unsigned i = 0; i < ruleProfiles.size(); i++) {
+		for (unsigned j = 0; j < ruleProfiles[i].size(); j++) {
+			rules.emplace_back(i,j);
+		}
+	}
+	// hot rules first, then the rules which were applicable but never fired
+	std::stable_sort(rules.begin(), rules.end(), [this](const std::pair<unsigned,unsigned>& a, const std::pair<unsigned,unsigned>& b) {
+		const RuleProfile& x = ruleProfiles[a.first][a.second];
+		const RuleProfile& y = ruleProfiles[b.first][b.second];
+		if (x.applications != y.applications) {
+			return x.applications > y.applications;
+		}
+		return x.applicable > y.applicable;
+	});
+	std::ofstream os(getRuleProfileFile());
+	if (!os) {
+		throw std::runtime_error("unable to write the rule profile file " + getRuleProfileFile());
+	}
+	std::size_t fired = 0;
+	os << "RULE PROFILE: " << rules.size() << " rules, " << configuration.time - initialTime << " steps\n";
+	os << "rank\tapplications\tapplicable\tevaluated steps";
+	if (isTimingRules()) {
+		os << "\tseconds";
+	}
+	os << "\trule\n";
+	for (unsigned k = 0; k < rules.size(); k++) {
+		const RuleProfile& profile = ruleProfiles[rules[k].first][rules[k].second];
+		if (profile.applications > 0) {
+			fired++;
+		}
+		os << k + 1 << "\t" << profile.applications << "\t" << profile.applicable << "\t" << profile.evaluatedSteps;
+		if (isTimingRules()) {
+			os << "\t" << profile.seconds;
+		}
+		os << "\t" << ruleTable[rules[k].first][rules[k].second] << "\n";
+	}
+	os << "NEVER FIRED: " << rules.size() - fired << " rules\n";
+	for (unsigned k = 0; k < rules.size(); k++) {
+		if (ruleProfiles[rules[k].first][rules[k].second].applications == 0) {
+			os << "\t" << ruleTable[rules[k].first][rules[k].second] << "\n";
+		}
+	}
+}
+
+inline
+void Simulator::writeProfile()
+{
+	if (isProfilingSteps()) {
+		profileStream << "{\"time\": " << configuration.time << ", \"profile\": ";
+		instrumentation.write(profileStream);
+		profileStream << "}" << std::endl;
+		totalInstrumentation.add(instrumentation);
+		instrumentation.clear();
+	} else {
+		totalInstrumentation = instrumentation;
+		instrumentation.write(profileStream);
+		profileStream << std::endl;
+	}
+}
+
+inline
+void Simulator::writeStatistics() const
+{
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	unsigned long steps = configuration.time - initialTime;
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	std::ofstream os(getStatsFile());
+	if (!os) {
+		throw std::runtime_error("unable to write the statistics file " + getStatsFile());
+	}
+	os << "{\"model\": \"" << getInputFile() << "\", "
+		<< "\"randomized\": " << (randomized ? "true" : "false") << ", "
+		<< "\"steps\": " << steps << ", "
+		<< "\"applications\": " << applications << ", "
+		<< "\"seconds\": " << seconds << ", "
+		<< "\"steps_per_second\": " << (seconds > 0 ? steps / seconds : 0) << ", "
+		<< "\"applications_per_second\": " << (seconds > 0 ? applications / seconds : 0) << ", "
+		<< "\"peak_rss_kb\": " << usage.ru_maxrss;
+	if (instrumentation.enabled) {
+		os << ", \"profile\": ";
+		totalInstrumentation.write(os);
+	}
+	os << "}" << std::endl;
 }
 
 inline
@@ -103,38 +472,106 @@ void Simulator::selectRules()
 	
 	selectedRules.clear();
 	
-	for (unsigned i = 0; i< configuration.membranes.size(); i++) {
-		configuration.membranes[i].semantics = file.psystem.semantics;
+	std::vector<unsigned> pending(activeMembranes.begin(), activeMembranes.end());
+	if (isMacroStepping()) {
+		scheduledMembranes = pending;
+	}
+	for (unsigned id : pending) {
+		configuration.membranes[id].semantics = file.psystem.semantics;
 	}
 	
-	do{
+	bool firstPass = true;
+	while (!pending.empty()) {
+		PhaseTimer timer(instrumentation, SELECTION_PASSES);
+		instrumentation.passes++;
 		remainingApplications = 0;
-		Shuffler<CMembrane> membranes(configuration.membranes, randomized);
+		std::vector<unsigned> next;
+		Shuffler<unsigned> membranes(pending, randomized, random, membraneBuffer);
 		for (unsigned i = 0; i < membranes.size(); i++) {
-			
-			if (membranes[i].parent==-2) { 
+			unsigned id = membranes[i];
+			CMembrane& m = configuration.membranes[id];
+			if (m.parent==-2) { 
+				activeMembranes.erase(id);
 				continue;
 			}
-			membranes[i].priorityLevel = std::numeric_limits<long>::max();
-			Shuffler<Rule> rules(ruleSets[membranes[i].label][membranes[i].charge],randomized);
+			if (pagedStore.isOpen()) {
+				pageIn(id);
+				if (m.parent>=0 && outerReaders[m.labelId]) {
+					pageIn(m.parent);
+				}
+				if (innerReaders[m.labelId]) {
+					for (int child : m.children) {
+						pageIn(child);
+					}
+				}
+			}
+			m.priorityLevel = std::numeric_limits<long>::max();
+			bool applicable = false;
+			std::size_t remaining = 0;
+			unsigned ruleIndex = getRuleIndex(m);
+			Shuffler<Rule> rules(ruleTable[ruleIndex], randomized, random, ruleBuffer, priorityRanks[ruleIndex]);
+			unsigned competing = 0;
+			if (randomized && isBinomialSelection()) {
+				competingRules.assign(rules.size(), false);
+				for (unsigned j = 0; j < rules.size(); j++) {
+					if (getMaxApplications(m,rules[j]) > 0) {
+						competingRules[j] = true;
+						competing++;
+					}
+				}
+			}
 			for (unsigned j = 0; j< rules.size(); j++) {
-				std::size_t max = getMaxApplications(membranes[i],rules[j]);
-				std::size_t applications = randomized ? RANDOM(max+1) : max;
-				if (rules[j].features.count("priority")>0) {
-					if (rules[j].features.at("priority").cast_long() > membranes[i].priorityLevel) {
+				std::size_t max = ruleProfiles.empty() ? getMaxApplications(m,rules[j]) : getProfiledMaxApplications(m,ruleIndex,rules(j));
+				std::size_t applications = max;
+				instrumentation.evaluatedRules++;
+				if (randomized && isBinomialSelection()) {
+					// a binomial share for every rule, conditioned on the previous ones,
+					// draws a multinomial distribution of the objects in a single pass
+					if (competingRules[j]) {
+						applications = competing > 1 ? random.binomial(max, 1.0 / competing) : max;
+						competing--;
+					}
+				} else if (randomized) {
+					applications = random(max+1);
+				}
+				if (rules[j].features.count(PRIORITY_FEATURE)>0) {
+					if (rules[j].features.at(PRIORITY_FEATURE).cast_long() > m.priorityLevel) {
 						applications = 0;
 					} else if (max > applications) {
-						membranes[i].priorityLevel = rules[j].features.at("priority").cast_long();
+						m.priorityLevel = rules[j].features.at(PRIORITY_FEATURE).cast_long();
 					}
 				}
 				if (applications>0) {
-					selectedRules[membranes(i)][rules(j)] += applications;
-					consume(membranes[i],rules[j],applications);
+					std::size_t& selected = selectedRules[id][rules(j)];
+					if (selected == 0) {
+						instrumentation.appliedRules++;
+					}
+					selected += applications;
+					this->applications += applications;
+					if (!ruleProfiles.empty()) {
+						ruleProfiles[ruleIndex][rules(j)].applications += applications;
+					}
+					consume(m,rules[j],applications);
+				}
+				applicable = applicable || max > 0;
+				remaining += (max - applications);
+			}
+			// consuming objects cannot enable rules, so a membrane without 
+			// applicable rules sleeps until produce() or the dissolution touch it
+			if (firstPass && !applicable && !pinnedLabels[m.labelId]) {
+				activeMembranes.erase(id);
+				if (pagedStore.isOpen() && getResidentMembranes() > getMaxResidentMembranes()) {
+					pageOut(id);
 				}
-				remainingApplications += (max - applications);
 			}
+			if (remaining > 0) {
+				next.push_back(id);
+			}
+			remainingApplications += remaining;
 		}
-	} while (remainingApplications > 0);
+		pending.swap(next);
+		firstPass = false;
+	}
 	
 	if (getVerbosityLevel()>1 && !selectedRules.empty()) {
 		std::cout<<"-----------------------------------------------\n\n";
@@ -142,7 +579,7 @@ void Simulator::selectRules()
 		for (auto it1 = selectedRules.begin(); it1 != selectedRules.end(); ++it1) {
 			CMembrane& m = configuration.membranes[it1->first];
 			std::cout << "\nMembrane ID: "<< it1->first << std::endl;
-			const std::vector<Rule>& rules = ruleSets[m.label][m.charge];
+			const std::vector<Rule>& rules = getRules(m);
 			for (auto it2 = it1->second.begin(); it2 != it1->second.end(); ++it2) {
 				std::cout<< it2->second <<" * "<< rules[it2->first] << std::endl;
 			}
@@ -151,16 +588,438 @@ void Simulator::selectRules()
 }
 
 
+inline
+void Simulator::touch(unsigned membraneId)
+{
+	touchedMembranes.insert(membraneId);
+	markLiveChange(membraneId);
+}
+
+inline
+void Simulator::markLiveChange(int membraneId)
+{
+	if (!liveView.isOpen()) {
+		return;
+	}
+	if (membraneId == -1) {
+		liveEnvironmentDirty = true;
+	} else {
+		liveDirty.push_back(membraneId);
+	}
+}
+
+inline
+void Simulator::touchEnvironment()
+{
+	environmentTouched = true;
+	liveEnvironmentDirty = true;
+}
+
+inline
+void Simulator::wakeUp()
+{
+	for (unsigned id : touchedMembranes) {
+		const CMembrane& m = configuration.membranes[id];
+		if (m.parent==-2) {
+			continue;
+		}
+		activeMembranes.insert(id);
+		if (m.parent>=0 && innerReaders[configuration.membranes[m.parent].labelId]) {
+			activeMembranes.insert(m.parent);
+		}
+		for (int child : m.children) {
+			if (outerReaders[configuration.membranes[child].labelId]) {
+				activeMembranes.insert(child);
+			}
+		}
+	}
+	if (environmentTouched) {
+		for (unsigned id : rootMembranes) {
+			if (outerReaders[configuration.membranes[id].labelId]) {
+				activeMembranes.insert(id);
+			}
+		}
+	}
+	touchedMembranes.clear();
+	environmentTouched = false;
+}
+
+inline
+void Simulator::pageIn(unsigned membraneId)
+{
+	if (!pagedStore.isOpen()) {
+		return;
+	}
+	if (membraneId >= pages.size()) {
+		pages.resize(configuration.membranes.size(),-1);
+		accesses.resize(configuration.membranes.size(),0);
+	}
+	accesses[membraneId]++;
+	if (pages[membraneId] == -1) {
+		return;
+	}
+	pagedStore.load(pages[membraneId],configuration.membranes[membraneId].multiset);
+	pages[membraneId] = -1;
+	pagedMembranes--;
+}
+
+inline
+void Simulator::pageInAll()
+{
+	for (unsigned i=0; i<pages.size() && pagedMembranes>0; i++) {
+		if (pages[i] != -1) {
+			pageIn(i);
+		}
+	}
+}
+
+inline
+void Simulator::pageOut()
+{
+	if (!pagedStore.isOpen()) {
+		return;
+	}
+	if (getResidentMembranes() <= getMaxResidentMembranes()) {
+		return;
+	}
+	pages.resize(configuration.membranes.size(),-1);
+	accesses.resize(configuration.membranes.size(),0);
+	
+	std::vector<std::pair<unsigned,unsigned>> candidates;
+	for (unsigned i=0; i<configuration.membranes.size(); i++) {
+		if (pages[i] == -1 && activeMembranes.count(i)==0) {
+			candidates.push_back(std::make_pair(accesses[i],i));
+		}
+	}
+	// go down to 3/4 of the limit, so the scan is amortized over several steps
+	std::size_t excess = getResidentMembranes() - getMaxResidentMembranes() * 3 / 4;
+	std::size_t n = std::min(excess,candidates.size());
+	std::nth_element(candidates.begin(),candidates.begin()+n,candidates.end());
+	for (unsigned i=0; i<n; i++) {
+		pageOut(candidates[i].second);
+	}
+	for (unsigned& a : accesses) {
+		a >>= 1;
+	}
+}
+
+inline
+void Simulator::pageOut(unsigned membraneId)
+{
+	if (membraneId >= pages.size()) {
+		pages.resize(configuration.membranes.size(),-1);
+		accesses.resize(configuration.membranes.size(),0);
+	}
+	CMembrane& m = configuration.membranes[membraneId];
+	if (pages[membraneId] != -1 || m.parent == -2 || exchangeTargets[m.labelId]) {
+		return;
+	}
+	if (liveView.isOpen()) {
+		updateLiveCounts(membraneId, m.multiset);
+	}
+	pages[membraneId] = pagedStore.save(m.multiset);
+	Multiset().swap(m.multiset);
+	pagedMembranes++;
+}
+
+inline
+int Simulator::findChild(const CMembrane& m, unsigned labelId, const char* charge) const
+{
+	for (int child : m.children) {
+		const CMembrane& c = configuration.membranes[child];
+		if (c.labelId == labelId && (charge == NULL || c.charge == *charge)) {
+			return child;
+		}
+	}
+	return -1;
+}
+
+inline
+int Simulator::findMembrane(unsigned labelId) const
+{
+	if (firstMembranes.empty()) {
+		firstMembranes.assign(labelIds.size(),-1);
+		for (int i=configuration.membranes.size()-1; i>=0; i--) {
+			firstMembranes[configuration.membranes[i].labelId] = i;
+		}
+	}
+	return firstMembranes[labelId];
+}
+
+inline
+unsigned Simulator::internLabel(const Label& label)
+{
+	auto it = labelIds.find(label);
+	if (it != labelIds.end()) {
+		return it->second;
+	}
+	unsigned id = labelIds.size();
+	labelIds[label] = id;
+	ruleTable.resize(ruleTable.size()+3);
+	priorityRanks.resize(ruleTable.size());
+	pinnedLabels.push_back(false);
+	outerReaders.push_back(false);
+	innerReaders.push_back(false);
+	exchangeTargets.push_back(false);
+	firstMembranes.clear();
+	return id;
+}
+
+inline
+void Simulator::internLabels(Rule& rule)
+{
+	rule.lhr.membrane.labelId = internLabel(rule.lhr.membrane.label);
+	for (IMembrane& im : rule.lhr.membrane.data) {
+		im.labelId = internLabel(im.label);
+	}
+	for (OMembrane& om : rule.rhr.data) {
+		om.labelId = internLabel(om.label);
+		for (IMembrane& im : om.data) {
+			im.labelId = internLabel(im.label);
+		}
+	}
+}
+
+inline
+std::size_t Simulator::getMultiplicity(const Place& place)
+{
+	if (place.first != -1) {
+		pageIn(place.first);
+	}
+	const Multiset& ms = place.first == -1 ? configuration.environment : configuration.membranes[place.first].multiset;
+	auto it = ms.find(place.second);
+	return it == ms.end() ? 0 : it->second.raw();
+}
+
+// In the deterministic mode every rule is applied a maximal number of times in a single 
+// pass over the scheduled membranes, so the selection can be replayed symbolically: 
+// for each rule the objects still available when it is evaluated grow linearly with 
+// the number of steps, and the selection stays the same while every selected rule 
+// keeps enough objects and at least one of its objects keeps limiting it.
+// Only rules without division, dissolution, charge changes or <--> are accepted, and 
+// their patterns must not be limited by the semantics of the model; otherwise the 
+// simulator falls back to single steps.
+inline
+std::size_t Simulator::getStableSteps(std::map<Place,long long>& delta)
+{
+	const std::size_t INF = std::numeric_limits<std::size_t>::max();
+	std::map<Place,std::size_t> consumed;
+	std::map<Place,std::size_t> produced;
+	
+	if (randomized || selectedRules.empty()) {
+		return 1;
+	}
+	
+	for (auto it1 = selectedRules.begin(); it1 != selectedRules.end(); ++it1) {
+		const CMembrane& m = configuration.membranes[it1->first];
+		const std::vector<Rule>& rules = getRules(m);
+		for (auto it2 = it1->second.begin(); it2 != it1->second.end(); ++it2) {
+			const Rule& r = rules[it2->first];
+			std::size_t a = it2->second;
+			if (r.arrow != 0 || r.rhr.data.size()!=1) {
+				return 1;
+			}
+			if (r.features.count(PATTERN_FEATURE)>0 && !isUnlimitedPattern(file.psystem.semantics,r.features.at(PATTERN_FEATURE).as_string())) {
+				return 1;
+			}
+			const OMembrane& om = r.rhr.data[0];
+			if (om.charge != r.lhr.membrane.charge || om.multiset.count(DISSOLUTION_OBJECT)>0) {
+				return 1;
+			}
+			for (auto it = r.lhr.multiset.begin(); it != r.lhr.multiset.end(); ++it) {
+				consumed[Place(m.parent,it->first)] += a * it->second.raw();
+			}
+			for (auto it = r.lhr.membrane.multiset.begin(); it != r.lhr.membrane.multiset.end(); ++it) {
+				consumed[Place(it1->first,it->first)] += a * it->second.raw();
+			}
+			for (const IMembrane& im : r.lhr.membrane.data) {
+				int child = findChild(m,im.labelId,&im.charge);
+				for (auto it = im.multiset.begin(); it != im.multiset.end(); ++it) {
+					consumed[Place(child,it->first)] += a * it->second.raw();
+				}
+			}
+			for (auto it = r.rhr.multiset.begin(); it != r.rhr.multiset.end(); ++it) {
+				produced[Place(m.parent,it->first)] += a * it->second.raw();
+			}
+			for (auto it = om.multiset.begin(); it != om.multiset.end(); ++it) {
+				produced[Place(it1->first,it->first)] += a * it->second.raw();
+			}
+			for (const IMembrane& im : om.data) {
+				int child = findChild(m,im.labelId,NULL);
+				if (child == -1 || configuration.membranes[child].charge != im.charge || im.multiset.count(DISSOLUTION_OBJECT)>0) {
+					return 1;
+				}
+				for (auto it = im.multiset.begin(); it != im.multiset.end(); ++it) {
+					produced[Place(child,it->first)] += a * it->second.raw();
+				}
+			}
+		}
+	}
+	
+	delta.clear();
+	for (auto it = consumed.begin(); it != consumed.end(); ++it) {
+		delta[it->first] -= it->second;
+	}
+	for (auto it = produced.begin(); it != produced.end(); ++it) {
+		delta[it->first] += it->second;
+	}
+	
+	// membranes evaluated in the next steps: the scheduled ones and the ones woken up by the productions
+	std::set<unsigned> membranes(scheduledMembranes.begin(), scheduledMembranes.end());
+	for (auto it = produced.begin(); it != produced.end(); ++it) {
+		int region = it->first.first;
+		if (region == -1) {
+			for (unsigned id : rootMembranes) {
+				if (outerReaders[configuration.membranes[id].labelId]) {
+					membranes.insert(id);
+				}
+			}
+			continue;
+		}
+		const CMembrane& m = configuration.membranes[region];
+		membranes.insert(region);
+		if (m.parent>=0 && innerReaders[configuration.membranes[m.parent].labelId]) {
+			membranes.insert(m.parent);
+		}
+		for (int child : m.children) {
+			if (outerReaders[configuration.membranes[child].labelId]) {
+				membranes.insert(child);
+			}
+		}
+	}
+	
+	std::size_t steps = INF;
+	std::map<Place,std::size_t> used;
+	std::vector<std::pair<Place,std::size_t>> requirements;
+	for (unsigned id : membranes) {
+		const CMembrane& m = configuration.membranes[id];
+		if (m.parent == -2) {
+			continue;
+		}
+		const std::vector<Rule>& rules = getRules(m);
+		auto selected = selectedRules.find(id);
+		for (unsigned j=0; j<rules.size(); j++) {
+			const Rule& r = rules[j];
+			if (r.arrow != 0) {
+				return 1;
+			}
+			if (r.features.count(PATTERN_FEATURE)>0 && !isUnlimitedPattern(file.psystem.semantics,r.features.at(PATTERN_FEATURE).as_string())) {
+				return 1;
+			}
+			std::size_t a = 0;
+			if (selected != selectedRules.end() && selected->second.count(j)>0) {
+				a = selected->second.at(j);
+			}
+			
+			requirements.clear();
+			for (auto it = r.lhr.multiset.begin(); it != r.lhr.multiset.end(); ++it) {
+				requirements.push_back(std::make_pair(Place(m.parent,it->first),it->second.raw()));
+			}
+			for (auto it = r.lhr.membrane.multiset.begin(); it != r.lhr.membrane.multiset.end(); ++it) {
+				requirements.push_back(std::make_pair(Place(id,it->first),it->second.raw()));
+			}
+			bool found = m.children.size() >= r.lhr.membrane.data.size();
+			for (unsigned i=0; i<r.lhr.membrane.data.size() && found; i++) {
+				const IMembrane& im = r.lhr.membrane.data[i];
+				int child = findChild(m,im.labelId,&im.charge);
+				found = child != -1;
+				for (auto it = im.multiset.begin(); it != im.multiset.end() && found; ++it) {
+					requirements.push_back(std::make_pair(Place(child,it->first),it->second.raw()));
+				}
+			}
+			if (!found) {
+				// the membrane structure does not change, so the rule is never applicable
+				continue;
+			}
+			if (requirements.empty()) {
+				return 1;
+			}
+			
+			std::size_t enough = INF;  // steps in which the rule keeps enough objects
+			std::size_t limited = 0;   // steps in which some object keeps limiting the rule
+			for (const auto& req : requirements) {
+				long long available = (long long)getMultiplicity(req.first) + (long long)consumed[req.first] - (long long)used[req.first];
+				long long slack = available - (long long)(a * req.second);
+				long long d = delta.count(req.first)>0 ? delta.at(req.first) : 0;
+				long long n = req.second;
+				if (slack < 0) {
+					return 1;
+				}
+				if (a > 0 && d < 0) {
+					enough = std::min(enough,(std::size_t)(slack / -d + 1));
+				}
+				if (slack < n) {
+					limited = d <= 0 ? INF : std::max(limited,(std::size_t)((n - slack - 1) / d + 1));
+				}
+			}
+			for (const auto& req : requirements) {
+				used[req.first] += a * req.second;
+			}
+			steps = std::min(steps,std::min(enough,limited));
+			if (steps <= 1) {
+				return 1;
+			}
+		}
+	}
+	
+	if (getMaxStepsToSimulate()>0) {
+		steps = std::min(steps,(std::size_t)(getMaxStepsToSimulate() - (configuration.time - initialTime)));
+	} else if (steps == INF) {
+		// the selection is repeated forever, so the simulation does not halt
+		return 1;
+	}
+	return std::max((std::size_t)1,steps);
+}
+
+inline
+void Simulator::macroStep()
+{
+	std::map<Place,long long> delta;
+	std::size_t steps = getStableSteps(delta);
+	if (steps <= 1) {
+		return;
+	}
+	// apply steps-1 complete steps, executeRules() applies the last one
+	for (auto it = delta.begin(); it != delta.end(); ++it) {
+		if (it->second == 0) {
+			continue;
+		}
+		Multiset& ms = it->first.first == -1 ? configuration.environment : configuration.membranes[it->first.first].multiset;
+		long long value = (long long)getMultiplicity(it->first) + it->second * (long long)(steps - 1);
+		if (value > 0) {
+			ms[it->first.second] = (std::size_t)value;
+		} else {
+			ms.erase(it->first.second);
+		}
+	}
+	configuration.time += steps - 1;
+	for (auto it1 = selectedRules.begin(); it1 != selectedRules.end(); ++it1) {
+		for (auto it2 = it1->second.begin(); it2 != it1->second.end(); ++it2) {
+			applications += it2->second * (steps - 1);
+			if (!ruleProfiles.empty()) {
+				ruleProfiles[getRuleIndex(configuration.membranes[it1->first])][it2->first].applications += it2->second * (steps - 1);
+			}
+		}
+	}
+	if (getVerbosityLevel()>1) {
+		std::cout<<"\nMACRO-STEP: the selected rules are applied during "<<steps<<" steps\n";
+	}
+}
+
 inline
 void Simulator::consume(CMembrane& m, const Rule& rule, std::size_t applications) 
 {
-	if (rule.features.count("pattern")>0) {
-		updateSemantics(m.semantics,rule.features.at("pattern").as_string(),applications);
+	PhaseTimer timer(instrumentation, CONSUMPTION);
+	if (rule.features.count(PATTERN_FEATURE)>0) {
+		updateSemantics(m.semantics,rule.features.at(PATTERN_FEATURE).as_string(),applications);
 	}
 	
 	
 	Multiset& pMs = m.parent == -1 ? configuration.environment : configuration.membranes[m.parent].multiset;
 	sub(pMs, rule.lhr.multiset, applications);
+	if (!rule.lhr.multiset.empty()) {
+		markLiveChange(m.parent);
+	}
 	sub(m.multiset,rule.lhr.membrane.multiset,applications);
 	bool found;
 	unsigned i;
@@ -168,7 +1027,7 @@ void Simulator::consume(CMembrane& m, const Rule& rule, std::size_t applications
 		found = false;
 		i=0;
 		while(i<m.children.size() && !found) {
-			if (configuration.membranes[m.children[i]].label == im.label && 
+			if (configuration.membranes[m.children[i]].labelId == im.labelId && 
 				configuration.membranes[m.children[i]].charge == im.charge) {
 				found = true;		
 			} else {
@@ -177,17 +1036,16 @@ void Simulator::consume(CMembrane& m, const Rule& rule, std::size_t applications
 		}
 		if (found) {
 			sub(configuration.membranes[m.children[i]].multiset,im.multiset,applications);
+			markLiveChange(m.children[i]);
 		}
 	}
 	
 	if (rule.arrow == 1 && rule.rhr.data[0].label[0] != "0") {
-		for (CMembrane& m : configuration.membranes) {
-			if (m.label == rule.rhr.data[0].label) {
-				sub(m.multiset, rule.rhr.data[0].multiset,applications);
-				break;
-			}
+		int target = findMembrane(rule.rhr.data[0].labelId);
+		if (target != -1) {
+			sub(configuration.membranes[target].multiset, rule.rhr.data[0].multiset,applications);
+			markLiveChange(target);
 		}
-		
 	}
 	
 }
@@ -230,19 +1088,20 @@ inline
 void Simulator::produce(unsigned membraneId, const OMembrane& lhrMembrane, const OMembrane& om, std::size_t applications, std::set<unsigned>& dissolving)
 {
 	CMembrane& m = configuration.membranes[membraneId];
+	touch(membraneId);
 	add(m.multiset,om.multiset,applications);
 	if (om.charge != lhrMembrane.charge) {
 		m.charge = om.charge;
 	}
-	if (m.multiset.count("@d")) {
-		m.multiset.erase("@d");
+	if (m.multiset.count(DISSOLUTION_OBJECT)) {
+		m.multiset.erase(DISSOLUTION_OBJECT);
 		dissolving.insert(membraneId);
 	}
 	for (const IMembrane& im : om.data) {
 		bool found = false;
 		unsigned i=0;
 		while(i<m.children.size() && !found) {
-			if (configuration.membranes[m.children[i]].label == im.label) {
+			if (configuration.membranes[m.children[i]].labelId == im.labelId) {
 				found = true;		
 			} else {
 				i++;
@@ -251,10 +1110,12 @@ void Simulator::produce(unsigned membraneId, const OMembrane& lhrMembrane, const
 		if (!found) {
 			throw new std::runtime_error("Unable to produce");
 		}
+		pageIn(m.children[i]);
 		configuration.membranes[m.children[i]].charge = im.charge;
 		add(configuration.membranes[m.children[i]].multiset,im.multiset,applications);
-		if (configuration.membranes[m.children[i]].multiset.count("@d")>0) {
-			configuration.membranes[m.children[i]].multiset.erase("@d");
+		touch(m.children[i]);
+		if (configuration.membranes[m.children[i]].multiset.count(DISSOLUTION_OBJECT)>0) {
+			configuration.membranes[m.children[i]].multiset.erase(DISSOLUTION_OBJECT);
 			dissolving.insert(m.children[i]);
 		}
 	}
@@ -264,6 +1125,7 @@ inline
 unsigned Simulator::copyMembrane(unsigned membraneId)
 {
 	unsigned index;
+	pageIn(membraneId);
 	if (freeIndexes.empty()) {
 		index = configuration.membranes.size();
 		configuration.membranes.resize(configuration.membranes.size()+1);
@@ -273,11 +1135,16 @@ unsigned Simulator::copyMembrane(unsigned membraneId)
 	}
 	configuration.membranes[index].charge = configuration.membranes[membraneId].charge;
 	configuration.membranes[index].label = configuration.membranes[membraneId].label;
+	configuration.membranes[index].labelId = configuration.membranes[membraneId].labelId;
+	firstMembranes.clear();
 	configuration.membranes[index].multiset = configuration.membranes[membraneId].multiset;
 	configuration.membranes[index].parent = configuration.membranes[membraneId].parent;
 	if (configuration.membranes[index].parent != -1) {
 		configuration.membranes[configuration.membranes[index].parent].children.push_back(index);
+	} else {
+		rootMembranes.insert(index);
 	}
+	touch(index);
 	
 	for (unsigned i=0;i<configuration.membranes[membraneId].children.size(); i++) {
 		configuration.membranes[index].children.push_back(copyMembrane(configuration.membranes[membraneId].children[i]));
@@ -295,21 +1162,30 @@ void Simulator::produce(unsigned membraneId, const Rule& rule, std::size_t appli
 	
 	if (rule.arrow == 1) {
 		add(m.multiset,rule.rhr.data[0].multiset,applications);
-		for (CMembrane& m1 : configuration.membranes) {
-			if (m1.label == rule.rhr.data[0].label) {
-				if (m1.label[0]=="0") {
-					add(m1.multiset,rule.lhr.membrane.multiset,1);
-				} else {
-					add(m1.multiset,rule.lhr.membrane.multiset,applications);
-				}
-				break;
+		touch(membraneId);
+		int target = findMembrane(rule.rhr.data[0].labelId);
+		if (target != -1) {
+			CMembrane& m1 = configuration.membranes[target];
+			if (m1.label[0]=="0") {
+				add(m1.multiset,rule.lhr.membrane.multiset,1);
+			} else {
+				add(m1.multiset,rule.lhr.membrane.multiset,applications);
 			}
+			touch(target);
 		}
 		return;
 		
 	}
 	
 	
+	if (!rule.rhr.multiset.empty()) {
+		if (m.parent == -1) {
+			touchEnvironment();
+		} else {
+			pageIn(m.parent);
+			touch(m.parent);
+		}
+	}
 	Multiset& pMs = m.parent == -1 ? configuration.environment : configuration.membranes[m.parent].multiset;
 	add(pMs,rule.rhr.multiset,applications);
 	if (rule.rhr.data.size()==0) {
@@ -317,7 +1193,11 @@ void Simulator::produce(unsigned membraneId, const Rule& rule, std::size_t appli
 		return;
 	} 
 	for (unsigned i = 1; i< rule.rhr.data.size(); i++) {
-		unsigned index = copyMembrane(membraneId);
+		unsigned index;
+		{
+			PhaseTimer timer(instrumentation, DIVISION);
+			index = copyMembrane(membraneId);
+		}
 		produce(index,rule.lhr.membrane,rule.rhr.data[i],applications,dissolving);
 	}
 	produce(membraneId,rule.lhr.membrane,rule.rhr.data[0],applications,dissolving);
@@ -334,57 +1214,82 @@ void Simulator::executeRules()
 	std::set<unsigned> dissolving;
 	
 	// First pass: no division
-	for (auto it1 = selectedRules.begin(); it1 != selectedRules.end(); ++it1) {
-		CMembrane& m = configuration.membranes[it1->first];
-		const std::vector<Rule>& rules = ruleSets[m.label][m.charge];
-		auto it2 = it1->second.begin();
-		while (it2 != it1->second.end()) {
-			const Rule& r = rules[it2->first];
-			if (r.rhr.data.size()>1) {
-				++it2;
-			} else {
-				produce(it1->first,r,it2->second,dissolving);
-				it2 = it1->second.erase(it2);
+	{
+		PhaseTimer timer(instrumentation, EXECUTION_FIRST_PASS);
+		for (auto it1 = selectedRules.begin(); it1 != selectedRules.end(); ++it1) {
+			CMembrane& m = configuration.membranes[it1->first];
+			const std::vector<Rule>& rules = getRules(m);
+			auto it2 = it1->second.begin();
+			while (it2 != it1->second.end()) {
+				const Rule& r = rules[it2->first];
+				if (r.rhr.data.size()>1) {
+					++it2;
+				} else {
+					produce(it1->first,r,it2->second,dissolving);
+					it2 = it1->second.erase(it2);
+				}
 			}
 		}
 	}
 	
 	// Second pass: division
-	for (auto it1 = selectedRules.begin(); it1 != selectedRules.end(); ++it1) {
-		CMembrane& m = configuration.membranes[it1->first];
-		const std::vector<Rule>& rules = ruleSets[m.label][m.charge];
-		for (auto it2 = it1->second.begin(); it2 != it1->second.end(); ++it2) {
-			const Rule& r = rules[it2->first];
-			produce(it1->first,r,it2->second,dissolving);
+	{
+		PhaseTimer timer(instrumentation, EXECUTION_SECOND_PASS);
+		for (auto it1 = selectedRules.begin(); it1 != selectedRules.end(); ++it1) {
+			CMembrane& m = configuration.membranes[it1->first];
+			const std::vector<Rule>& rules = getRules(m);
+			for (auto it2 = it1->second.begin(); it2 != it1->second.end(); ++it2) {
+				const Rule& r = rules[it2->first];
+				produce(it1->first,r,it2->second,dissolving);
+			}
 		}
 	}
 	
 	// dissolution
-	for (unsigned index : dissolving) {
-		CMembrane& m = configuration.membranes[index];
-		Multiset& pMs = m.parent == -1 ? configuration.environment : configuration.membranes[m.parent].multiset;
-		add(pMs,m.multiset,1);
-		if (m.parent != -1) {
-			for (unsigned i=0;i<configuration.membranes[m.parent].children.size();i++) {
-				if (configuration.membranes[m.parent].children[i]==(int)index) {
-					configuration.membranes[m.parent].children[i] = configuration.membranes[m.parent].children[configuration.membranes[m.parent].children.size()-1];
-					configuration.membranes[m.parent].children.resize(configuration.membranes[m.parent].children.size()-1);
-					break;
+	{
+		PhaseTimer timer(instrumentation, DISSOLUTION);
+		for (unsigned index : dissolving) {
+			CMembrane& m = configuration.membranes[index];
+			pageIn(index);
+			if (m.parent != -1) {
+				pageIn(m.parent);
+			}
+			Multiset& pMs = m.parent == -1 ? configuration.environment : configuration.membranes[m.parent].multiset;
+			add(pMs,m.multiset,1);
+			activeMembranes.erase(index);
+			rootMembranes.erase(index);
+			if (m.parent == -1) {
+				touchEnvironment();
+			} else {
+				touch(m.parent);
+			}
+			if (m.parent != -1) {
+				for (unsigned i=0;i<configuration.membranes[m.parent].children.size();i++) {
+					if (configuration.membranes[m.parent].children[i]==(int)index) {
+						configuration.membranes[m.parent].children[i] = configuration.membranes[m.parent].children[configuration.membranes[m.parent].children.size()-1];
+						configuration.membranes[m.parent].children.resize(configuration.membranes[m.parent].children.size()-1);
+						break;
+					}
 				}
 			}
-		}
-		for (unsigned i=0;i<m.children.size();i++) {
-			if (m.parent!=-1) {
-				configuration.membranes[m.parent].children.push_back(m.children[i]);
+			for (unsigned i=0;i<m.children.size();i++) {
+				if (m.parent!=-1) {
+					configuration.membranes[m.parent].children.push_back(m.children[i]);
+				} else {
+					rootMembranes.insert(m.children[i]);
+				}
+				configuration.membranes[m.children[i]].parent = m.parent;
+				touch(m.children[i]);
 			}
-			configuration.membranes[m.children[i]].parent = m.parent;
+			freeIndexes.push(index);
+			m.parent = -2;
+			m.multiset.clear();
+			m.children.clear();	
 		}
-		freeIndexes.push(index);
-		m.parent = -2;
-		m.multiset.clear();
-		m.children.clear();	
 	}
 	
+	wakeUp();
+	pageOut();
 	
 	configuration.time++;
 	
@@ -435,10 +1340,33 @@ std::size_t Simulator::getMaxApplications(const Semantics& semantics, const std:
 	return 0;
 }
 
+inline
+bool Simulator::isUnlimitedPattern(const Semantics& semantics, const std::string& pattern)
+{
+	bool found = false;
+	return isUnlimitedPattern(semantics,pattern,found) && found;
+}
+
+inline
+bool Simulator::isUnlimitedPattern(const Semantics& semantics, const std::string& pattern, bool& found)
+{
+	bool here = semantics.patterns.count(pattern)>0;
+	for (const Semantics& child : semantics.children) {
+		if (!isUnlimitedPattern(child,pattern,here)) {
+			return false;
+		}
+	}
+	if (here && !semantics.inf) {
+		return false;
+	}
+	found = found || here;
+	return true;
+}
 
 
 std::size_t Simulator::getMaxApplications(const CMembrane& m, const Rule& rule) const
 {
+	PhaseTimer timer(instrumentation, MAX_APPLICATIONS);
 	
 	const LHR& lhr = rule.lhr;
 	
@@ -448,8 +1376,8 @@ std::size_t Simulator::getMaxApplications(const CMembrane& m, const Rule& rule)
 	
 	std::size_t min = std::numeric_limits<std::size_t>::max();
 	
-	if (rule.features.count("pattern")>0) {
-		min = std::min(min,getMaxApplications(m.semantics,rule.features.at("pattern").as_string()));
+	if (rule.features.count(PATTERN_FEATURE)>0) {
+		min = std::min(min,getMaxApplications(m.semantics,rule.features.at(PATTERN_FEATURE).as_string()));
 		if (min==0) {
 			return 0;
 		}
@@ -475,7 +1403,7 @@ std::size_t Simulator::getMaxApplications(const CMembrane& m, const Rule& rule)
 		found = false;
 		i=0;
 		while(i<m.children.size() && !found) {
-			if (configuration.membranes[m.children[i]].label == im.label && 
+			if (configuration.membranes[m.children[i]].labelId == im.labelId && 
 				configuration.membranes[m.children[i]].charge == im.charge) {
 				found = true;		
 			} else {
@@ -493,23 +1421,19 @@ std::size_t Simulator::getMaxApplications(const CMembrane& m, const Rule& rule)
 	
 	
 	if (rule.arrow==1) {
-		found = false;
-		for (const CMembrane& m : configuration.membranes) {
-			if (m.label == rule.rhr.data[0].label) {
-				found=true;
-				if (m.label[0]=="0") {
-					if (count(rule.rhr.data[0].multiset,m.multiset)==0) {
-						min=0;
-					}
-				} else {
-					min = std::min(min,count(rule.rhr.data[0].multiset,m.multiset));
+		int target = findMembrane(rule.rhr.data[0].labelId);
+		if (target == -1) {
+			min = 0;
+		} else {
+			const CMembrane& m = configuration.membranes[target];
+			if (m.label[0]=="0") {
+				if (count(rule.rhr.data[0].multiset,m.multiset)==0) {
+					min=0;
 				}
-				break;
+			} else {
+				min = std::min(min,count(rule.rhr.data[0].multiset,m.multiset));
 			}
 		}
-		if (!found) {
-			min = 0;
-		}
 		
 	}
 	
@@ -546,13 +1470,13 @@ std::size_t Simulator::count(const Multiset& ms0, const Multiset& ms1)
 inline
 bool Simulator::ruleSupportedArrow0(const Rule& rule)
 {
-	if (rule.lhr.multiset.count("@d")>0 || rule.lhr.membrane.multiset.count("@d") || rule.rhr.multiset.count("@d")>0) {
+	if (rule.lhr.multiset.count(DISSOLUTION_OBJECT)>0 || rule.lhr.membrane.multiset.count(DISSOLUTION_OBJECT) || rule.rhr.multiset.count(DISSOLUTION_OBJECT)>0) {
 		return false;
 	}
 	
 	for (unsigned i=0;i< rule.rhr.data.size(); i++) {
 		
-		if (rule.rhr.data[i].multiset.count("@d")>0 && rule.rhr.data.size()>1) {
+		if (rule.rhr.data[i].multiset.count(DISSOLUTION_OBJECT)>0 && rule.rhr.data.size()>1) {
 			return false;
 		}
 		
@@ -567,10 +1491,10 @@ bool Simulator::ruleSupportedArrow0(const Rule& rule)
 			if (rule.lhr.membrane.data[j].label != rule.rhr.data[i].data[j].label) {
 				return false;
 			}
-			if (rule.lhr.membrane.data[j].multiset.count("@d")>0) {
+			if (rule.lhr.membrane.data[j].multiset.count(DISSOLUTION_OBJECT)>0) {
 				return false;
 			}
-			if (rule.rhr.data[i].data[j].multiset.count("@d")>0 && rule.rhr.data.size()>1) {
+			if (rule.rhr.data[i].data[j].multiset.count(DISSOLUTION_OBJECT)>0 && rule.rhr.data.size()>1) {
 				return false;
 			}	
 		}
@@ -604,7 +1528,7 @@ bool Simulator::ruleSupportedArrow1(const Rule& rule)
 	}
 	
 		
-	if (rule.lhr.membrane.multiset.count("@d")>0 || rule.rhr.data[0].multiset.count("@d")>0) {
+	if (rule.lhr.membrane.multiset.count(DISSOLUTION_OBJECT)>0 || rule.rhr.data[0].multiset.count(DISSOLUTION_OBJECT)>0) {
 		return false;
 	}
 	
@@ -615,7 +1539,7 @@ bool Simulator::ruleSupportedArrow1(const Rule& rule)
 inline
 bool Simulator::ruleSupported(const Rule& rule)
 {
-	if  (rule.features.count("probability")> 0) {
+	if  (rule.features.count(PROBABILITY_FEATURE)> 0) {
 		return false;
 	}
 	
@@ -636,8 +1560,23 @@ inline
 bool Simulator::parse(int argc, char *argv[])
 {
 	
-	ruleSets.clear();
+	labelIds.clear();
+	ruleTable.clear();
+	priorityRanks.clear();
+	firstMembranes.clear();
 	selectedRules.clear();
+	activeMembranes.clear();
+	touchedMembranes.clear();
+	environmentTouched = false;
+	rootMembranes.clear();
+	pinnedLabels.clear();
+	outerReaders.clear();
+	innerReaders.clear();
+	exchangeTargets.clear();
+	pages.clear();
+	accesses.clear();
+	pagedMembranes = 0;
+	pagedStore.close();
 	while(!freeIndexes.empty()) {
 		freeIndexes.pop();
 	}
@@ -649,12 +1588,77 @@ bool Simulator::parse(int argc, char *argv[])
 		return false;
 	}
 
-	loadFromFile(getInputFile(),file);
+	if (!getTraceFile().empty()) {
+		TRACER.enable(getTraceFile(), getMaxTraceEvents());
+	}
+	const std::string& input = getInputFile();
+	if (input.size()>4 && input.compare(input.size()-4,4,".pli")==0) {
+		TraceSpan span("compile","psim");
+		plingua::parser::CompileOptions options;
+		options.includePaths = getIncludePaths();
+		if (!plingua::parser::compile({input},file,options)) {
+			throw std::runtime_error("unable to compile '" + input + "'");
+		}
+	} else {
+		TraceSpan span("loadFromFile","psim");
+		loadFromFile(input,file);
+	}
 	
+	for (const Rule& rule : file.psystem.rules) {
+		if (rule.arrow == 1 && !rule.rhr.data.empty()) {
+			exchangeTargets[internLabel(rule.rhr.data[0].label)] = true;
+		}
+	}
+	if (getMaxResidentMembranes()>0) {
+		pagedStore.open(getPageFile());
+	}
+	// the live view is opened before the configuration, membranes paged out while it is
+	// built are counted by pageOut()
+	liveObjects.clear();
+	liveNames.clear();
+	liveTotals.assign(LiveSnapshot::MAX_OBJECTS, 0);
+	liveTotalObjects = 0;
+	liveUntracked = 0;
+	liveCounts.clear();
+	liveEnvironment.clear();
+	liveDirty.clear();
+	if (!getLiveViewName().empty()) {
+		liveView.open(getLiveViewName());
+	} else {
+		liveView.close();
+	}
+	
+	PruningReport report;
+	Reachability reachability;
 	if (getConfigurationFile().empty()) {
+		if (isPruning()) {
+			reachability.prune(file.psystem,report);
+		}
 		initConfigurationRec(file.psystem.structure, -1);
 	} else {
 		loadFromFile(getConfigurationFile(),configuration);
+		if (isPruning()) {
+			reachability.prune(file.psystem,configuration,report);
+		}
+		for (unsigned i=0; i<configuration.membranes.size(); i++) {
+			configuration.membranes[i].labelId = internLabel(configuration.membranes[i].label);
+			if (configuration.membranes[i].parent == -2) {
+				continue;
+			}
+			activeMembranes.insert(i);
+			if (configuration.membranes[i].parent == -1) {
+				rootMembranes.insert(i);
+			}
+			if (pagedStore.isOpen() && getResidentMembranes() > getMaxResidentMembranes()) {
+				pageOut(i);
+			}
+		}
+	}
+	
+	if (isPruning() && getVerbosityLevel()>0) {
+		std::cout<<"// REACHABILITY ANALYSIS:\n";
+		std::cout<<report<<"\n";
+		std::cout<<"***********************************************\n\n";
 	}
 	
 	for (const Rule& rule : file.psystem.rules) {
@@ -665,41 +1669,112 @@ bool Simulator::parse(int argc, char *argv[])
 			 std::cout << ss.str() <<std::endl;
 			 throw new std::runtime_error(ss.str());
 		}
-		ruleSets[rule.lhr.membrane.label][rule.lhr.membrane.charge].push_back(rule);
+		Rule r = rule;
+		internLabels(r);
+		unsigned id = r.lhr.membrane.labelId;
+		getRules(r.lhr.membrane).push_back(r);
+		if (rule.arrow == 1) {
+			pinnedLabels[id] = true;
+		}
+		if (!rule.lhr.multiset.empty()) {
+			outerReaders[id] = true;
+		}
+		if (!rule.lhr.membrane.data.empty()) {
+			innerReaders[id] = true;
+		}
 	}	
 	
 	struct {
 		inline bool operator()(const Rule& a, const Rule& b)  {
 						
-			if (a.features.count("priority") > 0 && b.features.count("priority") > 0) {
-				long x = a.features.at("priority").cast_long();
-				long y = b.features.at("priority").cast_long();
+			if (a.features.count(PRIORITY_FEATURE) > 0 && b.features.count(PRIORITY_FEATURE) > 0) {
+				long x = a.features.at(PRIORITY_FEATURE).cast_long();
+				long y = b.features.at(PRIORITY_FEATURE).cast_long();
 				return x < y;
 			}
 			return a < b;
 		}
 	} customLess;
 	
-	for (auto it1 = ruleSets.begin(); it1 != ruleSets.end(); ++it1) {
-		for (auto it2 = it1->second.begin(); it2 != it1->second.end(); ++it2) {
-			std::vector<Rule>& rules = it2->second;
-			std::sort(rules.begin(),rules.end(),customLess);
+	priorityRanks.assign(ruleTable.size(), std::vector<unsigned>());
+	for (unsigned i = 0; i < ruleTable.size(); i++) {
+		std::vector<Rule>& rules = ruleTable[i];
+		std::sort(rules.begin(),rules.end(),customLess);
+		// rank 0 for the lowest priority value, which is applied first
+		std::vector<long> values;
+		for (const Rule& rule : rules) {
+			if (rule.features.count(PRIORITY_FEATURE) > 0) {
+				values.push_back(rule.features.at(PRIORITY_FEATURE).cast_long());
+			}
+		}
+		if (values.empty()) {
+			continue;
+		}
+		std::sort(values.begin(), values.end());
+		values.erase(std::unique(values.begin(), values.end()), values.end());
+		for (const Rule& rule : rules) {
+			if (rule.features.count(PRIORITY_FEATURE) == 0) {
+				priorityRanks[i].push_back(NO_PRIORITY);
+			} else {
+				long value = rule.features.at(PRIORITY_FEATURE).cast_long();
+				priorityRanks[i].push_back(std::lower_bound(values.begin(), values.end(), value) - values.begin());
+			}
 		}
 	}
 	
 	if (!randomized) {
 		randomized = file.psystem.features.count("randomized");
 	}
+	random.setSeed(isSeeded() ? getSeed() : RANDOM.getSeed());
 	if (getVerbosityLevel()>1) {
 		std::cout<<"// P SYSTEM TO SIMULATE:\n";
 		std::cout<<getFile()<<"\n\n";
+		if (randomized) {
+			std::cout<<"// RANDOM SEED: "<<random.getSeed()<<"\n\n";
+		}
 		std::cout<<"***********************************************\n\n";
 	}
 	if (getVerbosityLevel()>0) {
 		std::cout<<getCurrentConfiguration()<<std::endl;
 	}
 	initialTime = configuration.time;
+	applications = 0;
+	ruleProfiles.clear();
+	if (!getRuleProfileFile().empty()) {
+		for (const std::vector<Rule>& rules : ruleTable) {
+			ruleProfiles.emplace_back(rules.size());
+		}
+	}
+	instrumentation.clear();
+	totalInstrumentation.clear();
+	instrumentation.enabled = !getProfileFile().empty();
+	if (profileStream.is_open()) {
+		profileStream.close();
+	}
+	if (instrumentation.enabled) {
+		profileStream.open(getProfileFile());
+		if (!profileStream) {
+			throw std::runtime_error("unable to write the profile file " + getProfileFile());
+		}
+	}
+	if (memoryStream.is_open()) {
+		memoryStream.close();
+	}
+	if (!getMemoryFile().empty()) {
+		memoryStream.open(getMemoryFile());
+		if (!memoryStream) {
+			throw std::runtime_error("unable to write the memory report file " + getMemoryFile());
+		}
+	}
+	startTime = std::chrono::steady_clock::now();
 	finished = false;
+	if (liveView.isOpen()) {
+		for (unsigned id = 0; id < configuration.membranes.size(); id++) {
+			liveDirty.push_back(id);
+		}
+		liveEnvironmentDirty = true;
+		publishLiveView();
+	}
 	return true;
 }
 
@@ -710,8 +1785,13 @@ void Simulator::initConfigurationRec(const Membrane& membrane, int parent)
 	configuration.membranes.emplace_back();
 	CMembrane& c = configuration.membranes.back();
 	c.label = membrane.label;
+	c.labelId = internLabel(membrane.label);
 	c.charge = membrane.charge;
 	c.parent = parent;
+	activeMembranes.insert(index);
+	if (parent==-1) {
+		rootMembranes.insert(index);
+	}
 	
 	if (file.psystem.multisets.count(membrane.label)>0) {
 		c.multiset = file.psystem.multisets.at(membrane.label);
@@ -720,6 +1800,9 @@ void Simulator::initConfigurationRec(const Membrane& membrane, int parent)
 	if (parent!=-1) {
 		configuration.membranes[parent].children.push_back(index);
 	}
+	if (pagedStore.isOpen() && getResidentMembranes() > getMaxResidentMembranes()) {
+		pageOut(index);
+	}
 	for (const Membrane& m : membrane.data) {
 		initConfigurationRec(m,index);
 	}
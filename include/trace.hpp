@@ -0,0 +1,171 @@
+
+#ifndef _TRACE_HPP_
+#define _TRACE_HPP_
+#include <chrono>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <unistd.h>
+
+/**
+ * class Tracer
+ *
+ * Recorder of Chrome/Perfetto trace events (chrome://tracing, ui.perfetto.dev)
+ * implemented by using the singleton pattern.
+ * Spans are kept as complete events in a bounded ring buffer, so only the
+ * latest events are written when the buffer is full, and recording a span
+ * costs a branch while tracing is disabled.
+ * The trace is written when the program finishes.
+ */
+
+class Tracer
+{
+public:
+	static const std::size_t DEFAULT_CAPACITY = 1 << 16;
+	Tracer(Tracer const&) = delete;
+        void operator=(Tracer const&)  = delete;
+	~Tracer() {write();}
+        /**
+   	 * Get the singleton instance of Tracer
+	 * Note: You can use the macro TRACER instead of Tracer::getInstance()
+   	 * @return the singleton instance
+   	 */
+	static Tracer& getInstance()
+   	{
+      		static Tracer singleton;
+      		return singleton;
+	}
+	#define TRACER Tracer::getInstance()
+	/**
+	 * Start tracing
+	 * @param path: the file for the trace
+	 * @param capacity: the maximum number of events kept
+	 */
+	void enable(const std::string& path, std::size_t capacity = DEFAULT_CAPACITY);
+	bool isEnabled() const {return enabled;}
+	/**
+	 * Get the time since the tracer was created
+	 * @return: microseconds
+	 */
+	double now() const {return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origin).count();}
+	/**
+	 * Record a complete event
+	 * @param name: the name of the span, it should be a string literal
+	 * @param category: the category of the span, it should be a string literal
+	 * @param start: the start time given by now()
+	 * @param duration: the duration in microseconds
+	 */
+	void record(const char* name, const char* category, double start, double duration);
+	/**
+	 * Write the recorded events to the trace file
+	 */
+	void write();
+private:
+	Tracer() : enabled(false), next(0), size(0), nextThread(0), origin(std::chrono::steady_clock::now()) {}
+	// small sequential id of the calling thread
+	unsigned getThreadId();
+
+	struct Event {
+		const char* name;
+		const char* category;
+		double start;
+		double duration;
+		unsigned thread;
+	};
+
+	bool enabled;
+	std::string path;
+	std::vector<Event> events;
+	std::size_t next;
+	std::size_t size;
+	std::mutex mutex;
+	std::atomic<unsigned> nextThread;
+	std::chrono::steady_clock::time_point origin;
+};
+
+/**
+ * class TraceSpan
+ *
+ * Record the scope where it is declared as a span of the trace
+ */
+
+class TraceSpan
+{
+public:
+	TraceSpan(const char* name, const char* category)
+	: name(name), category(category), start(TRACER.isEnabled() ? TRACER.now() : 0) {}
+	~TraceSpan()
+	{
+		if (TRACER.isEnabled()) {
+			TRACER.record(name, category, start, TRACER.now() - start);
+		}
+	}
+	TraceSpan(TraceSpan const&) = delete;
+	void operator=(TraceSpan const&) = delete;
+private:
+	const char* name;
+	const char* category;
+	double start;
+};
+
+inline
+void Tracer::enable(const std::string& path, std::size_t capacity)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	this->path = path;
+	events.assign(capacity > 0 ? capacity : 1, Event());
+	next = 0;
+	size = 0;
+	enabled = true;
+}
+
+inline
+unsigned Tracer::getThreadId()
+{
+	thread_local unsigned id = nextThread++;
+	return id;
+}
+
+inline
+void Tracer::record(const char* name, const char* category, double start, double duration)
+{
+	unsigned thread = getThreadId();
+	std::lock_guard<std::mutex> lock(mutex);
+	Event& event = events[next];
+	event.name = name;
+	event.category = category;
+	event.start = start;
+	event.duration = duration;
+	event.thread = thread;
+	next = (next + 1) % events.size();
+	if (size < events.size()) {
+		size++;
+	}
+}
+
+inline
+void Tracer::write()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!enabled) {
+		return;
+	}
+	std::ofstream os(path);
+	if (!os) {
+		return;
+	}
+	os << std::fixed << std::setprecision(3) << "{\"traceEvents\": [\n";
+	std::size_t first = (next + events.size() - size) % events.size();
+	for (std::size_t i = 0; i < size; i++) {
+		const Event& event = events[(first + i) % events.size()];
+		os << (i > 0 ? ",\n" : "") << "{\"name\": \"" << event.name << "\", \"cat\": \"" << event.category
+			<< "\", \"ph\": \"X\", \"ts\": " << event.start << ", \"dur\": " << event.duration
+			<< ", \"pid\": " << getpid() << ", \"tid\": " << event.thread << "}";
+	}
+	os << "\n], \"displayTimeUnit\": \"ms\"}" << std::endl;
+}
+
+#endif
@@ -26,6 +26,23 @@ bool codify(Format format, const File& file, const std::string& path)   {
 }
 
 
+bool isArchive(Format format) {
+	return format == JSON || format == XML || format == BINARY || format == PORTABLE;
+}
+
+
+bool codifyStreamed(Format format, const File& file, const parser::RuleSpool& rules, const std::string& path) {
+	StreamedFile<parser::RuleSpool> data(file, rules);
+	switch(format) {
+		case JSON      : saveToJsonFile(path, data); return true;
+		case XML       : saveToXmlFile(path, data); return true;
+		case BINARY    : saveToBinaryFile(path, data); return true;
+		case PORTABLE  : saveToPortableBinaryFile(path, data); return true;
+		default        : printFatalMessage("Invalid format for streaming"); return false;
+	}
+}
+
+
 
 bool codifyJson(const File& file, const std::string& path)  {
 	saveToJsonFile(path,file);
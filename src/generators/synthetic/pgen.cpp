@@ -0,0 +1,53 @@
+#include <iostream>
+#include <chrono>
+#include <boost/program_options.hpp>
+
+#include <generators/synthetic.hpp>
+
+// Generator of synthetic P systems for stress tests, the output can be
+// simulated by psim like the files written by plingua
+
+using namespace plingua;
+using namespace plingua::generators;
+namespace po = boost::program_options;
+
+int main(int argc, char *argv[])
+{
+	SyntheticParameters parameters;
+	po::options_description desc("Options");
+	desc.add_options()
+	("help,h", "show this help")
+	("output,o", po::value<std::string>(), "output file, the format is given by the extension (.json .xml .bin .bin2)")
+	("membranes,n", po::value<unsigned>(&parameters.membranes)->default_value(parameters.membranes), "membranes in the initial structure, skin included")
+	("depth,d", po::value<unsigned>(&parameters.depth)->default_value(parameters.depth), "maximum nesting depth")
+	("labels,l", po::value<unsigned>(&parameters.labels)->default_value(parameters.labels), "labels of the non-skin membranes")
+	("alphabet,a", po::value<unsigned>(&parameters.alphabet)->default_value(parameters.alphabet), "number of objects")
+	("rules,r", po::value<unsigned>(&parameters.rules)->default_value(parameters.rules), "rules per label")
+	("lhs,w", po::value<unsigned>(&parameters.lhs)->default_value(parameters.lhs), "objects in the left-hand side of every rule")
+	("multiplicity,m", po::value<unsigned>(&parameters.multiplicity)->default_value(parameters.multiplicity), "copies of every object in the initial multisets")
+	("division", po::value<double>(&parameters.division)->default_value(parameters.division), "fraction of division rules in elementary labels")
+	("dissolution", po::value<double>(&parameters.dissolution)->default_value(parameters.dissolution), "fraction of dissolution rules in non-skin labels")
+	("competition,c", po::value<double>(&parameters.competition)->default_value(parameters.competition), "probability of a left-hand side object being shared by the rules of a label")
+	("seed,s", po::value<unsigned>(&parameters.seed)->default_value(parameters.seed), "seed of the generator");
+	try {
+		po::variables_map vm;
+		po::store(po::parse_command_line(argc, argv, desc), vm);
+		po::notify(vm);
+		if (vm.count("help") || !vm.count("output")) {
+			std::cout << "usage: " << argv[0] << " -o file [options]" << std::endl << desc << std::endl;
+			return vm.count("help") ? 0 : 1;
+		}
+		File file;
+		generateSynthetic(parameters, file);
+		auto start = std::chrono::steady_clock::now();
+		saveToFile(vm["output"].as<std::string>(), file);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::cout << vm["output"].as<std::string>() << ": " << parameters.membranes << " membranes, "
+			<< file.psystem.rules.size() << " rules, written in " << seconds << " s" << std::endl;
+	} catch (std::exception& ex) {
+		std::cout << ex.what() << std::endl;
+		std::cout << "type '" << argv[0] << " --help' for help" << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,301 @@
+#include <string>
+#include <parser/bytecode.hpp>
+#include "y.tab.h"
+using namespace plingua::parser;
+
+
+static bool apply(Opcode opcode, NodeValue* stack, unsigned& sp)
+{
+	switch (opcode) {
+		case OP_CAST_LONG:
+			stack[sp-1] = stack[sp-1].castLong();
+		break;
+		case OP_CAST_DOUBLE:
+			stack[sp-1] = stack[sp-1].castDouble();
+		break;
+		case OP_CAST_STRING:
+			stack[sp-1] = stack[sp-1].castString();
+		break;
+		case OP_MINUS:
+			stack[sp-1] = -stack[sp-1];
+		break;
+		case OP_NOT:
+			stack[sp-1] = !stack[sp-1];
+		break;
+		case OP_BITWISE_NOT:
+			stack[sp-1] = ~stack[sp-1];
+		break;
+		case OP_MUL:
+			stack[sp-2] = stack[sp-2] * stack[sp-1];
+			sp--;
+		break;
+		case OP_DIV:
+			stack[sp-2] = stack[sp-2] / stack[sp-1];
+			sp--;
+		break;
+		case OP_MOD:
+			stack[sp-2] = stack[sp-2] % stack[sp-1];
+			sp--;
+		break;
+		case OP_ADD:
+			stack[sp-2] = stack[sp-2] + stack[sp-1];
+			sp--;
+		break;
+		case OP_SUB:
+			stack[sp-2] = stack[sp-2] - stack[sp-1];
+			sp--;
+		break;
+		case OP_BITWISE_LEFT:
+			stack[sp-2] = stack[sp-2] << stack[sp-1];
+			sp--;
+		break;
+		case OP_BITWISE_RIGHT:
+			stack[sp-2] = stack[sp-2] >> stack[sp-1];
+			sp--;
+		break;
+		case OP_LESS_THAN:
+			stack[sp-2] = stack[sp-2] < stack[sp-1];
+			sp--;
+		break;
+		case OP_LESS_OR_EQUAL_THAN:
+			stack[sp-2] = stack[sp-2] <= stack[sp-1];
+			sp--;
+		break;
+		case OP_GREATER_THAN:
+			stack[sp-2] = stack[sp-2] > stack[sp-1];
+			sp--;
+		break;
+		case OP_GREATER_OR_EQUAL_THAN:
+			stack[sp-2] = stack[sp-2] >= stack[sp-1];
+			sp--;
+		break;
+		case OP_EQUAL:
+			stack[sp-2] = stack[sp-2] == stack[sp-1];
+			sp--;
+		break;
+		case OP_DIFF:
+			stack[sp-2] = stack[sp-2] != stack[sp-1];
+			sp--;
+		break;
+		case OP_BITWISE_AND:
+			stack[sp-2] = stack[sp-2] & stack[sp-1];
+			sp--;
+		break;
+		case OP_BITWISE_OR:
+			stack[sp-2] = stack[sp-2] | stack[sp-1];
+			sp--;
+		break;
+		case OP_BITWISE_XOR:
+			stack[sp-2] = stack[sp-2] ^ stack[sp-1];
+			sp--;
+		break;
+		default:
+			return false;
+	}
+	return stack[sp-1].isValid();
+}
+
+
+static bool getOpcode(int type, Opcode& opcode, int& operands)
+{
+	operands = 2;
+	switch (type) {
+		case INT_TYPE: case LONG_TYPE: opcode = OP_CAST_LONG; operands = 1; break;
+		case DOUBLE_TYPE: opcode = OP_CAST_DOUBLE; operands = 1; break;
+		case STRING_TYPE: opcode = OP_CAST_STRING; operands = 1; break;
+		case MINUS: opcode = OP_MINUS; operands = 1; break;
+		case NOT: opcode = OP_NOT; operands = 1; break;
+		case BITWISE_NOT: opcode = OP_BITWISE_NOT; operands = 1; break;
+		case MUL: opcode = OP_MUL; break;
+		case DIV: opcode = OP_DIV; break;
+		case MOD: opcode = OP_MOD; break;
+		case ADD: opcode = OP_ADD; break;
+		case SUB: opcode = OP_SUB; break;
+		case BITWISE_LEFT: opcode = OP_BITWISE_LEFT; break;
+		case BITWISE_RIGHT: opcode = OP_BITWISE_RIGHT; break;
+		case LESS_THAN: opcode = OP_LESS_THAN; break;
+		case LESS_OR_EQUAL_THAN: opcode = OP_LESS_OR_EQUAL_THAN; break;
+		case GREATER_THAN: opcode = OP_GREATER_THAN; break;
+		case GREATER_OR_EQUAL_THAN: opcode = OP_GREATER_OR_EQUAL_THAN; break;
+		case EQUAL: opcode = OP_EQUAL; break;
+		case DIFF: opcode = OP_DIFF; break;
+		case BITWISE_AND: opcode = OP_BITWISE_AND; break;
+		case BITWISE_OR: opcode = OP_BITWISE_OR; break;
+		case BITWISE_XOR: opcode = OP_BITWISE_XOR; break;
+		default: return false;
+	}
+	return true;
+}
+
+
+Bytecode* Bytecode::compile(const Node& node, const std::vector<std::string>& slots, unsigned index)
+{
+	Bytecode* bytecode = new Bytecode(index);
+	if (!bytecode->compileNode(node,slots,0)) {
+		delete bytecode;
+		return NULL;
+	}
+	return bytecode;
+}
+
+
+bool Bytecode::compileNode(const Node& node, const std::vector<std::string>& slots, unsigned height)
+{
+	if (height >= MAX_DEPTH) {
+		return false;
+	}
+	switch (node.getType()) {
+		case NON_NEGATIVE_LONG:
+		case NON_NEGATIVE_DOUBLE:
+		case STRING:
+			code.push_back({OP_CONSTANT, (unsigned)constants.size()});
+			constants.push_back(node.getValue());
+			return true;
+		case VARIABLE:
+			return compileVariable(node,slots,height);
+		case PLUS:
+			// unary plus gives the value of its operand
+			return node.size()==1 && compileNode(node[0],slots,height);
+		default:
+		;
+	}
+	Opcode opcode;
+	int operands;
+	if (!getOpcode(node.getType(),opcode,operands) || node.size()!=operands) {
+		return false;
+	}
+	for (int i=0;i<operands;i++) {
+		if (!compileNode(node[i],slots,height+i)) {
+			return false;
+		}
+	}
+	code.push_back({opcode, 0});
+	fold(operands);
+	return true;
+}
+
+
+bool Bytecode::compileVariable(const Node& node, const std::vector<std::string>& slots, unsigned height)
+{
+	if (node.size()==0 || node[0].getType()!=ID) {
+		return false;
+	}
+	Name name;
+	name.id = node[0].getValue().getString();
+	if (node.size()==1) {
+		for (unsigned i=0;i<slots.size();i++) {
+			if (slots[i]==name.id) {
+				code.push_back({OP_SLOT, i});
+				return true;
+			}
+		}
+		code.push_back({OP_VARIABLE, (unsigned)names.size()});
+		names.push_back(name);
+		return true;
+	}
+	unsigned n = 0;
+	for (int i=1;i<node.size();i++) {
+		if (node[i].getType()!=INDEXES) {
+			return false;
+		}
+		for (int j=0;j<node[i].size();j++) {
+			if (!compileNode(node[i][j],slots,height+n)) {
+				return false;
+			}
+			n++;
+		}
+		name.indexes.push_back(node[i].size());
+	}
+	code.push_back({OP_INDEXED, (unsigned)names.size()});
+	names.push_back(name);
+	return true;
+}
+
+
+void Bytecode::fold(unsigned operands)
+{
+	if (code.size() < operands+1) {
+		return;
+	}
+	for (unsigned i=code.size()-operands-1;i<code.size()-1;i++) {
+		if (code[i].opcode!=OP_CONSTANT) {
+			return;
+		}
+	}
+	// the operands are the last constants, invalid results are computed at run time to report the errors
+	NodeValue stack[2];
+	unsigned sp = operands;
+	for (unsigned i=0;i<operands;i++) {
+		stack[i] = constants[constants.size()-operands+i];
+	}
+	if (!apply(code.back().opcode,stack,sp)) {
+		return;
+	}
+	code.resize(code.size()-operands-1);
+	constants.resize(constants.size()-operands);
+	code.push_back({OP_CONSTANT, (unsigned)constants.size()});
+	constants.push_back(stack[0]);
+}
+
+
+bool Bytecode::evaluate(const Memory& memory, const NodeValue* slots, NodeValue& result) const
+{
+	NodeValue stack[MAX_DEPTH];
+	unsigned sp = 0;
+	std::string variable;
+	for (const Instruction& instruction : code) {
+		switch (instruction.opcode) {
+			case OP_CONSTANT:
+				stack[sp++] = constants[instruction.operand];
+			break;
+			case OP_SLOT:
+				if (!slots[instruction.operand].isValid()) {
+					return false;
+				}
+				stack[sp++] = slots[instruction.operand];
+			break;
+			case OP_VARIABLE: {
+				const NodeValue& value = memory.getVariable(names[instruction.operand].id);
+				if (!value.isValid()) {
+					return false;
+				}
+				stack[sp++] = value;
+			}
+			break;
+			case OP_INDEXED: {
+				// same name as Parser::getVariableAsString
+				const Name& name = names[instruction.operand];
+				for (unsigned size : name.indexes) {
+					sp -= size;
+				}
+				variable = name.id;
+				const NodeValue* index = stack + sp;
+				for (unsigned size : name.indexes) {
+					variable += "{";
+					for (unsigned j=0;j<size;j++,index++) {
+						if (!index->isValid() || !index->isLong()) {
+							return false;
+						}
+						variable += std::to_string(index->getLong());
+						if (j+1<size) {
+							variable += ",";
+						}
+					}
+					variable += "}";
+				}
+				const NodeValue& value = memory.getVariable(variable);
+				if (!value.isValid()) {
+					return false;
+				}
+				stack[sp++] = value;
+			}
+			break;
+			default:
+				if (!apply(instruction.opcode,stack,sp)) {
+					return false;
+				}
+		}
+	}
+	result = stack[0];
+	return true;
+}
@@ -5,6 +5,7 @@
 #include <formats.hpp>
 #include <parser/parser.hpp>
 #include <parser/constants.hpp>
+#include <trace.hpp>
 #include <gpl.hpp>
 #include "y.tab.h"
 
@@ -114,35 +115,77 @@ void Parser::printAbout() const
 }
 
 
-void Parser::init(int argc, char* argv[])
+void Parser::reset()
 {
-	using namespace std;
-	namespace po = boost::program_options;
-	
-	
 	memory.clear();
 	root.clear();
+	mainCall.clear();
+	modules.clear();
+	compiledSentences.clear();
+	arena.clear();
 	root.setType(PLINGUA);
+	mainCall.setType(CALL)->addChild(new Node(ID,arena.copy("main")))->setInvalidLoc();
 	lines.clear();
 	currentFile=0;
 	currentLine=0;
 	currentColumn=0;
 	errorCounter=0;
 	warningCounter=0;
-	modules.clear();
 	files.clear();
 	includePaths.clear();
 	verbosityLevel=2;
+	usingColors = true;
 	hasStructure = false;
+	pruning = false;
+	streaming = false;
+	spool.close();
 	file.header = FILE_HEADER;
 	file.version = FILE_VERSION;
-	file.psystem.model.str().clear();
+	file.psystem.model = "";
 	file.psystem.structure.data.clear();
 	file.psystem.rules.clear();
 	file.psystem.multisets.clear();	
 	file.psystem.features.clear();
 	patterns.clear();
+	patternCache.clear();
+	compilation++;
 	models.clear();
+	outputFile.clear();
+	outputFormat = formatId[defaultFormat];
+}
+
+void Parser::setup(const std::vector<std::string>& input, const CompileOptions& options)
+{
+	usingColors = options.usingColors;
+	pruning = options.pruning;
+	verbosityLevel = options.verbosityLevel;
+	if (verbosityLevel<0) {
+		verbosityLevel=0;
+		error("The verbosity level should be >= 0",LEVEL_FATAL);
+	}
+	
+	unsigned threads = options.threads>0 ? options.threads : std::thread::hardware_concurrency();
+	workers.start(threads > 1 ? threads - 1 : 0);
+	
+	for (const std::string& path : options.includePaths) {
+		addIncludePath(path);
+	}
+	
+	for (const std::string& name : input) {
+		addFile(name.c_str(),false);
+	}
+	
+	if (files.empty()) {
+		error("no input files", LEVEL_FATAL);
+	}
+}
+
+void Parser::init(int argc, char* argv[])
+{
+	using namespace std;
+	namespace po = boost::program_options;
+	
+	reset();
 	po::options_description desc("Allowed options");
 	desc.add_options()
 	("help,h", "show this help message")
@@ -156,6 +199,12 @@ void Parser::init(int argc, char* argv[])
 	("list,l", "show a list of allowed output formats")
 	("global,g", po::value< vector<string> >(), "set a global variable")
 	("no-color,n", "set the standard output without ASCII color codes")
+	("prune,p", "remove rules, objects and labels that can never be used")
+	("stream,s", "keep the unrolled rules in a temporary file instead of in memory and write them to the output in the order they are found (json, xml, bin and bin2 formats)")
+	("families", "write the rules which only differ in their indexes, labels and multiplicities as ranges of parameters, psim expands them when the file is read (json, xml, bin and bin2 formats)")
+	("trace", po::value< string>(), "write a Chrome/Perfetto trace of the compilation phases to a file")
+	("trace-events", po::value<unsigned>(), "set the maximum number of trace events kept, the latest ones are written")
+	("threads,j", po::value<unsigned>(), "set the number of threads unrolling the ranges of rules and multisets, by default one per core")
 	("input", po::value< vector<string> >(), "set the input file and its arguments")
 	;
 	
@@ -263,43 +312,65 @@ void Parser::init(int argc, char* argv[])
 			error(os.str().c_str(),LEVEL_FATAL);
 			return;
 		}
-	} else {
-		outputFormat = formatId[defaultFormat];
 	}
 	
 	
 	if (vm.count("output")) {
 		outputFile = vm["output"].as<string>();
 	}
-		
 	
-
-		
-	if (vm.count("verbosity")) {
-		verbosityLevel = vm["verbosity"].as<int>();
-		if (verbosityLevel<0) {
-			verbosityLevel=0;
-			error("The verbosity level should be >= 0",LEVEL_FATAL);
+	if (vm.count("trace")) {
+		std::size_t capacity = Tracer::DEFAULT_CAPACITY;
+		if (vm.count("trace-events")) {
+			capacity = vm["trace-events"].as<unsigned>();
 		}
+		TRACER.enable(vm["trace"].as<string>(), capacity);
 	}
 	
+	CompileOptions options;
+	options.usingColors = usingColors;
+	options.pruning = vm.count("prune")>0;
+	if (vm.count("verbosity")) {
+		options.verbosityLevel = vm["verbosity"].as<int>();
+	}
+	if (vm.count("threads")) {
+		// 0 threads is the default of CompileOptions, one per core
+		options.threads = std::max(vm["threads"].as<unsigned>(),1u);
+	}
 	if (vm.count("include")) {
-		const vector<string>& paths = vm["include"].as< vector<string> >();
-		for (unsigned i=0;i<paths.size();i++) {
-			addIncludePath(paths[i]);
-		}
+		options.includePaths = vm["include"].as< vector<string> >();
 	}
+	vector<string> input;
+	if (vm.count("input")) {
+		input = vm["input"].as< vector<string> >();
+	}
+	setup(input,options);
 	
+	unsigned format = 0;
+	while (format < maxFormats && outputFormat.compare(formatId[format])!=0) {
+		format++;
+	}
 	
-	if (vm.count("input")) {
-		const vector<string>& inputFiles = vm["input"].as< vector<string> >();
-		for (unsigned i=0;i<inputFiles.size();i++) {
-			addFile(inputFiles[i].c_str(),false);
+	if (vm.count("stream")) {
+		if (outputFile.empty() || pruning || verbosityLevel>=LEVEL_DEBUG_3 || !isArchive((Format)format)) {
+			error("ignoring --stream, it needs an output file in json, xml, bin or bin2 format, no pruning and a verbosity level lower than 6",LEVEL_WARNING);
+		} else {
+			try {
+				spool.open();
+				streaming = true;
+			}
+			catch(exception& ex) {
+				error(ex.what(),LEVEL_FATAL);
+				return;
+			}
 		}
 	}
 	
-	if (files.empty()) {
-		error("no input files", LEVEL_FATAL);
+	if (vm.count("families")) {
+		if (isArchive((Format)format)) {
+			file.version = FAMILIES_FILE_VERSION;
+		} else {
+			error("ignoring --families, it needs the json, xml, bin or bin2 format",LEVEL_WARNING);
+		}
 	}
-	
 }
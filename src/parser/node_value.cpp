@@ -52,10 +52,16 @@ char* NodeValue::parseString(char* str)
 			str[writingIndex++] = str[readingIndex-1]; 
 		}
 	}
-	str = (char*)realloc(str,writingIndex+1);
 	str[writingIndex]='\0';
 	return str;
 }
+
+NodeValue NodeValue::view(char* value)
+{
+	NodeValue view(CSTR,value);
+	view.flags |= VIEW_MASK;
+	return view;
+}
 	
 	
 char* NodeValue::reverse(char *str)
@@ -112,7 +118,7 @@ NodeValue& NodeValue::operator =(const NodeValue& other)
 	
 		case STR:
 		case CSTR:
-			value.stringValue = strdup(other.value.stringValue);
+			value.stringValue = other.isView() ? other.value.stringValue : strdup(other.value.stringValue);
 		break;
 		
 		default:
@@ -720,7 +726,7 @@ NodeValue::~NodeValue()
 NodeValue& NodeValue::clear()
 {
 	NodeValueType type = (NodeValueType)(flags & TYPE_MASK);
-	if (type==STR || type==CSTR) {
+	if ((type==STR || type==CSTR) && !isView()) {
 		free(value.stringValue);
 	}	
 	flags = NO_ERROR | UNKNOWN;
@@ -7,8 +7,11 @@
 #include <algorithm>
 #include <unordered_set>
 #include <formats.hpp>
+#include <reachability.hpp>
+#include <trace.hpp>
 #include <parser/gtest.hpp>
 #include <parser/parser.hpp>
+#include <parser/compiler.hpp>
 #include <parser/constants.hpp>
 #include "y.tab.h"
 
@@ -23,12 +26,16 @@ extern int yyparse();
 const std::string RETURN_VARIABLE("@return");
 const FloatingPoint<double> FLOATING_POINT_ZERO(FloatingPoint<double>::kZeroValueInBits);
 const FloatingPoint<double> FLOATING_POINT_ONE(FloatingPoint<double>::kOneValueInBits);
+// minimum estimated number of unrolled sentences to split a range across the workers
+const unsigned long PARALLEL_UNROLLING = 1024;
+
+thread_local Parser::Unrolling* Parser::unrolling = NULL;
+thread_local Parser::ComposedNames Parser::composedNames;
+const Parser::CompiledSentence Parser::WALKED_SENTENCE = {-1,0};
 
 Parser::Parser() 
-: mainCall(CALL,new Node(ID,strdup("main"))),
-  usingColors(true)
+: compilation(0), usingColors(true)
 {
-	mainCall.setInvalidLoc();
 }
 		
 const char* Parser::getColorCode(Color color) const
@@ -112,6 +119,11 @@ void Parser::update()
 
 void Parser::error(const char* s, ErrorLevel level, bool printProgramName)
 {
+	// hidden info messages have no effects, anything else is reported by the sequential unrolling
+	if (unrolling!=NULL && unrolling->worker) {
+		unrolling->failed = unrolling->failed || level<LEVEL_INFO || verbosityLevel>=level;
+		return;
+	}
 	if (verbosityLevel>=level) {
 		if (printProgramName) {
 			fprintf(stdout,"%s%s: %s", getColorCode(BOLDWHITE),PROGRAM_NAME.c_str(),getColorCode(RESET));
@@ -135,6 +147,10 @@ void Parser::error(const char* s, ErrorLevel level, bool printProgramName)
 
 void Parser::error(const char* s, const YYLTYPE& location, ErrorLevel level)
 {
+	if (unrolling!=NULL && unrolling->worker) {
+		error(s,level);
+		return;
+	}
 	if (verbosityLevel>=level && location.valid) {
 		location.print(stdout);
 	}
@@ -188,6 +204,7 @@ bool Parser::findMembrane(const Label& label, const Membrane& membrane)
 
 bool Parser::addSemantics()
 {
+	patternCache.clear();
 	if (file.psystem.model.str().empty()) {
 		error("no model defined",LEVEL_WARNING);
 		patterns.clear();
@@ -216,6 +233,7 @@ bool Parser::addSemantics()
 
 bool Parser::checkData()
 {
+	TraceSpan span("checkData","plingua");
 	bool success = true;
 	if (!hasStructure && !outputFile.empty()) {
 		error("missing initial membrane structure");
@@ -225,8 +243,28 @@ bool Parser::checkData()
 }
 
 
+bool Parser::prune()
+{
+	if (!pruning) {
+		return true;
+	}
+	TraceSpan span("prune","plingua");
+	PruningReport report;
+	Reachability reachability;
+	reachability.prune(file.psystem,report);
+	std::ostringstream os;
+	os << "pruned " << report.rules.size() << " rules, " << report.objects.size() << " objects and " << report.labels.size() << " labels";
+	error(os.str().c_str(),LEVEL_INFO);
+	if (verbosityLevel>=LEVEL_DEBUG_1) {
+		std::cout << report;
+	}
+	return true;
+}
+
+
 bool Parser::generateOutput()
 {
+	TraceSpan span("generateOutput","plingua");
 	if (verbosityLevel>=LEVEL_DEBUG_3) {
 		std::cout << file << "\n";
 	}
@@ -247,6 +285,9 @@ bool Parser::generateOutput()
 		error(os.str().c_str(),LEVEL_FATAL);
 	    return false;
 	}
+	if (streaming) {
+		return codifyStreamed(format,file,spool,outputFile);
+	}
 	return codify(format,file,outputFile);
 }
 
@@ -254,6 +295,33 @@ bool Parser::generateOutput()
 int Parser::parse(int argc, char* argv[])
 {
 	init(argc,argv);
+	if (compileFiles()) {
+		generateOutput();
+	}
+	finish();
+	TRACER.write();
+	return errorCounter==0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}	
+
+bool Parser::compile(const std::vector<std::string>& input, const CompileOptions& options, File& output)
+{
+	reset();
+	setup(input,options);
+	bool success = errorCounter==0 && compileFiles();
+	if (success && verbosityLevel>=LEVEL_DEBUG_3) {
+		std::cout << file << "\n";
+	}
+	finish();
+	// the workers are not kept waiting in the process of the caller
+	workers.stop();
+	if (success) {
+		output = std::move(file);
+	}
+	return success;
+}
+
+bool Parser::compileFiles()
+{
 	for(unsigned i=0; i< files.size(); i++) {
 		readLines(i);
 		currentFile = i;
@@ -270,17 +338,22 @@ int Parser::parse(int argc, char* argv[])
 			error(buffer.c_str(),LEVEL_FATAL);
 			continue;
 		}
+		TraceSpan span("yyparse","plingua");
 		do{
 			yyparse();
 		}while(!feof(yyin));
 		fclose(yyin);
 	}
-	if (errorCounter==0 && root.size()>0 &&
-		   addSemantics() &&
-	       unrollSentence(mainCall) && 
-	       errorCounter==0 && checkData() ) {
-		generateOutput();
+	bool success = errorCounter==0 && root.size()>0 && addSemantics();
+	if (success) {
+		TraceSpan span("unrollSentence","plingua");
+		success = unrollSentence(mainCall);
 	}
+	return success && errorCounter==0 && checkData() && prune();
+}
+
+void Parser::finish() const
+{
 	if (verbosityLevel>=LEVEL_DEBUG_2) {
 		memory.printMemory(stdout);
 	}
@@ -288,8 +361,15 @@ int Parser::parse(int argc, char* argv[])
 		root.print(stdout);
 	}
 	finishMessage();
-	return errorCounter==0 ? EXIT_SUCCESS : EXIT_FAILURE;
-}	
+}
+
+bool plingua::parser::compile(const std::vector<std::string>& input, File& file, const CompileOptions& options)
+{
+	// the parser and the scanner are global
+	static std::mutex mutex;
+	std::lock_guard<std::mutex> lock(mutex);
+	return PARSER.compile(input,options,file);
+}
 
 void Parser::finishMessage() const
 {
@@ -336,6 +416,82 @@ bool Parser::getVariableAsString(Node& variable, std::string& str)
 }
 
 
+bool Parser::getObject(Node& variable, ObjectString& object)
+{
+	// the key is kept on a stack, modules called by the indexes push their keys above it
+	static thread_local std::vector<long> key;
+	std::size_t base = key.size();
+	const Node* id = NULL;
+	bool success = true;
+	for (int i=0;i<variable.size();i++) {
+		if (variable[i].getType()==ID) {
+			id = &variable[i];
+		} else if (variable[i].getType()==INDEXES) {
+			key.push_back(variable[i].size());
+			for(int j=0;j<variable[i].size();j++) {
+				const NodeValue& value = computeValue(variable[i][j]);
+				if ((!value.isError() && value.isUnknown()) || value.isGenericError() || (value.isValid() && !value.isLong())) {
+					error("invalid index",variable[i][j].getLocation());
+				}
+				if (!value.isValid() || !value.isLong()) {
+					success=false;
+				} else {
+					key.push_back(value.getLong());
+				}
+			}
+		}
+	}
+	if (!success || id==NULL) {
+		key.resize(base);
+		object = ObjectString();
+		return false;
+	}
+	// the name is hashed from its parts and only built the first time
+	const char* name = id->getValue().getString();
+	std::size_t length = 0;
+	std::size_t hash = key.size()-base;
+	for (;name[length]!=0;length++) {
+		hash = hash*31 + name[length];
+	}
+	for (std::size_t i=base;i<key.size();i++) {
+		hash = hashCombine(hash, key[i]);
+	}
+	ComposedNames& composed = composedNames;
+	if (composed.compilation != compilation) {
+		composed.names.clear();
+		composed.keys.clear();
+		composed.compilation = compilation;
+	}
+	auto range = composed.names.equal_range(hash);
+	for (auto it = range.first; it != range.second; ++it) {
+		const ComposedName& entry = it->second;
+		const std::string& str = entry.object.str();
+		if (entry.size==key.size()-base && std::equal(key.begin()+base,key.end(),composed.keys.begin()+entry.key) &&
+			str.compare(0,length,name)==0 && (str.size()==length || str[length]=='{')) {
+			object = entry.object;
+			key.resize(base);
+			return true;
+		}
+	}
+	std::string str = name;
+	for (std::size_t i=base;i<key.size();i+=key[i]+1) {
+		str+="{";
+		for (long j=1;j<=key[i];j++) {
+			str+=std::to_string(key[i+j]);
+			if (j<key[i]) {
+				str+=",";
+			}
+		}
+		str+="}";
+	}
+	composed.names.emplace(hash,ComposedName{(unsigned)composed.keys.size(),(unsigned)(key.size()-base),str});
+	composed.keys.insert(composed.keys.end(),key.begin()+base,key.end());
+	object = str;
+	key.resize(base);
+	return true;
+}
+
+
 const NodeValue& Parser::setVariable(Node& node, const NodeValue& value) 
 {
 	std::string aux;
@@ -520,8 +676,205 @@ bool Parser::unrollSentence(Node& sentence)
 	if (sentence.size()==0 || sentence[sentence.size()-1].getType()!=RANGES) {
 		return unrollSentenceB(sentence);
 	}
-	
-	return unrollSentenceR(sentence,sentence[sentence.size()-1],0);
+	Node& ranges = sentence[sentence.size()-1];
+	const CompiledSentence& compiled = unrolling==NULL ? compileSentence(sentence) : WALKED_SENTENCE;
+	if (compiled.slots < 0) {
+		return unrollSentenceR(sentence,ranges,0);
+	}
+	if (memory.containsLocalVariable(RETURN_VARIABLE)) {
+		return true;
+	}
+	// the range variables live in slots during the expansion and are stored in memory at the end
+	Unrolling context(ranges,compiled);
+	unrolling = &context;
+	bool success;
+	if (!unrollSentenceP(sentence,ranges,success)) {
+		success = unrollSentenceC(sentence,ranges,0);
+	}
+	storeSlots();
+	unrolling = NULL;
+	return success;
+}
+
+const Parser::CompiledSentence& Parser::compileSentence(Node& sentence)
+{
+	// debug levels trace every access to the variables
+	if (verbosityLevel>=LEVEL_DEBUG_1) {
+		return WALKED_SENTENCE;
+	}
+	auto it = compiledSentences.find(&sentence);
+	if (it != compiledSentences.end()) {
+		return it->second;
+	}
+	int type = sentence.getType();
+	Node& ranges = sentence[sentence.size()-1];
+	std::vector<std::string> slotNames;
+	std::vector<std::pair<Node*,Bytecode*>> compiled;
+	// only sentences without side effects, the range variables cannot have indexes
+	bool success = type==RULE || type==MS || type==MU || type==EMU;
+	for (int i=0;success && i<ranges.size();i++) {
+		if (ranges[i].getType()==DIFF) {
+			continue;
+		}
+		Node& variable = ranges[i][2];
+		if (variable.size()!=1 || variable[0].getType()!=ID) {
+			success = false;
+		} else if (std::find(slotNames.begin(),slotNames.end(),variable[0].getValue().getString())==slotNames.end()) {
+			slotNames.push_back(variable[0].getValue().getString());
+		}
+	}
+	success = success && compileExpressions(sentence,slotNames,false,compiled);
+	for (auto& entry : compiled) {
+		if (success) {
+			entry.first->setBytecode(entry.second);
+		} else {
+			delete entry.second;
+		}
+	}
+	CompiledSentence& result = compiledSentences[&sentence];
+	result.slots = success ? (int)slotNames.size() : -1;
+	result.expressions = success ? compiled.size() : 0;
+	return result;
+}
+
+bool Parser::compileExpressions(Node& node, const std::vector<std::string>& slotNames, bool feature, std::vector<std::pair<Node*,Bytecode*>>& compiled)
+{
+	// every expression gets its own bytecode, unroll functions compute subexpressions like indexes on their own;
+	// expressions without children are markers, like the += of @ms, and features assign values to names
+	if (node.isExpression() && node.size()>0 && !(feature && node.getType()==ASIG)) {
+		Bytecode* bytecode = Bytecode::compile(node,slotNames,compiled.size());
+		if (bytecode==NULL) {
+			return false;
+		}
+		compiled.push_back({&node,bytecode});
+	}
+	for (int i=0;i<node.size();i++) {
+		// the comparisons of a range are markers
+		if (node.getType()==RANGE && (i==1 || i==3)) {
+			continue;
+		}
+		if (!compileExpressions(node[i],slotNames,feature || node.getType()==FEATURE,compiled)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void Parser::storeSlots()
+{
+	Node& ranges = *unrolling->ranges;
+	for (int i=0;i<ranges.size();i++) {
+		if (ranges[i].getType()==DIFF) {
+			continue;
+		}
+		int slot = ranges[i][2].getBytecode()->getSlot();
+		if (unrolling->assignedSlots[slot]) {
+			setVariable(ranges[i][2],unrolling->slots[slot]);
+		}
+	}
+}
+
+// value of a compiled expression, false if it cannot be computed without errors
+static bool evaluate(const Node& node, const Memory& memory, const NodeValue* slots, NodeValue& value)
+{
+	if (node.getBytecode()==NULL) {
+		value = node.getValue();
+		return value.isConstant() && value.isValid();
+	}
+	return node.getBytecode()->evaluate(memory,slots,value);
+}
+
+// bounds of a compiled range, false if they cannot be computed without errors
+static bool getBounds(const Node& range, const Memory& memory, const NodeValue* slots, long& from, long& to)
+{
+	NodeValue fromValue, toValue;
+	if (!evaluate(range[0],memory,slots,fromValue) || !evaluate(range[4],memory,slots,toValue)) {
+		return false;
+	}
+	from = fromValue.castLong().getLong();
+	to = toValue.castLong().getLong();
+	if (range[1].getType()==LESS_THAN) {
+		from++;
+	}
+	if (range[3].getType()==LESS_OR_EQUAL_THAN) {
+		to++;
+	}
+	return true;
+}
+
+bool Parser::unrollSentenceP(Node& sentence, Node& ranges, bool& success)
+{
+	// the outermost range is split across the workers, they unroll rules and multisets into buffers
+	// which are merged in the sequential order, returns false if the sentence was not unrolled
+	Node& outer = ranges[ranges.size()-1];
+	if (workers.size()<2 || (sentence.getType()!=RULE && sentence.getType()!=MS) || outer.getType()==DIFF) {
+		return false;
+	}
+	long from, to;
+	if (!getBounds(outer,memory,unrolling->slots.data(),from,to) || to-from < 2) {
+		return false;
+	}
+	// the inner ranges of the first iteration give an estimation of the work
+	std::vector<NodeValue> slots(unrolling->slots);
+	slots[outer[2].getBytecode()->getSlot()] = NodeValue(from);
+	unsigned long estimation = to-from;
+	for (int i=ranges.size()-2;i>=0 && estimation<PARALLEL_UNROLLING;i--) {
+		long a, b;
+		if (ranges[i].getType()==DIFF) {
+			continue;
+		}
+		if (!getBounds(ranges[i],memory,slots.data(),a,b)) {
+			return false;
+		}
+		estimation *= b-a > 1 ? b-a : 1;
+		slots[ranges[i][2].getBytecode()->getSlot()] = NodeValue(a);
+	}
+	if (estimation < PARALLEL_UNROLLING) {
+		return false;
+	}
+	unsigned long iterations = to-from;
+	unsigned chunks = iterations < workers.size()*4 ? iterations : workers.size()*4;
+	std::vector<Unrolling> contexts(chunks,*unrolling);
+	Unrolling* context = unrolling;
+	int slot = outer[2].getBytecode()->getSlot();
+	unsigned expressions = compiledSentences[&sentence].expressions;
+	workers.run(chunks,[&](unsigned chunk) {
+		Unrolling& worker = contexts[chunk];
+		worker.worker = true;
+		worker.values.resize(expressions);
+		unrolling = &worker;
+		long end = from + iterations*(chunk+1)/chunks;
+		for (long i=from + iterations*chunk/chunks;i<end && !worker.failed;i++) {
+			worker.slots[slot].set(NodeValue(i),false);
+			worker.assignedSlots[slot] = true;
+			if (!unrollSentenceC(sentence,ranges,1)) {
+				worker.failed = true;
+			}
+		}
+		unrolling = NULL;
+	});
+	unrolling = context;
+	for (const Unrolling& worker : contexts) {
+		if (worker.failed) {
+			return false;
+		}
+	}
+	success = true;
+	for (Unrolling& worker : contexts) {
+		for (Rule& rule : worker.rules) {
+			success = addRule(sentence,rule) ? success : false;
+		}
+		for (auto& multiset : worker.multisets) {
+			success = addMultiset(sentence,std::get<0>(multiset),std::get<1>(multiset),std::get<2>(multiset)) ? success : false;
+		}
+		for (unsigned i=0;i<worker.slots.size();i++) {
+			if (worker.assignedSlots[i]) {
+				unrolling->slots[i] = worker.slots[i];
+				unrolling->assignedSlots[i] = true;
+			}
+		}
+	}
+	return true;
 }
 
 bool Parser::unrollSentenceR(Node& sentence, Node& ranges, int index)
@@ -587,6 +940,64 @@ bool Parser::unrollSentenceR(Node& sentence, Node& ranges, int index)
 	return true;
 }
 
+bool Parser::unrollSentenceC(Node& sentence, Node& ranges, int index)
+{
+	if (index==ranges.size()) {
+		for (int i = 0; i< ranges.size();i++) {
+			if (ranges[i].getType()==DIFF) {
+				const NodeValue& a = computeValue(ranges[i][0]);
+				const NodeValue& b = computeValue(ranges[i][1]);
+				if ((!a.isError() && a.isUnknown()) || a.isGenericError()) {
+					error("invalid expression",ranges[i][0].getLocation());
+				}
+				if ((!b.isError() && b.isUnknown()) || b.isGenericError()) {
+					error("invalid expression",ranges[i][1].getLocation());
+				}
+				if (!a.isValid() || !b.isValid()) {
+					return false;
+				}
+				NodeValue r = a!=b;
+				if (r.isFalse()) {
+					return true;
+				} 
+			}
+		}
+		return unrollSentenceB(sentence);
+	}
+	Node& range = ranges[ranges.size()-index-1];
+	if (range.getType()==DIFF) {
+		return unrollSentenceC(sentence,ranges,index+1);
+	}
+	const NodeValue& fromValue = computeValue(range[0]);
+	const NodeValue& toValue = computeValue(range[4]);
+	if ((!fromValue.isError() && fromValue.isUnknown()) || fromValue.isGenericError()) {
+		error("invalid range",range[0].getLocation());
+	}
+	if ((!toValue.isError() && toValue.isUnknown()) || toValue.isGenericError()) {
+		error("invalid range",range[4].getLocation());
+	}
+	if (!fromValue.isValid() || !toValue.isValid()) {
+		return false;
+	} 
+	long from = fromValue.castLong().getLong();
+	long to = toValue.castLong().getLong();
+	if (range[1].getType()==LESS_THAN) {
+		from++;
+	}
+	if (range[3].getType()==LESS_OR_EQUAL_THAN) {
+		to++;
+	}
+	int slot = range[2].getBytecode()->getSlot();
+	for (long i=from;i<to;i++) {
+		unrolling->slots[slot].set(NodeValue(i),false);
+		unrolling->assignedSlots[slot] = true;
+		if (!unrollSentenceC(sentence,ranges,index+1)) {
+			return false;
+		}
+	}
+	return true;
+}
+
 bool Parser::unrollSentenceB(Node& sentence)
 {
 	switch (sentence.getType()) {
@@ -726,18 +1137,18 @@ bool Parser::unrollMultiset(Node& sentence, Multiset& multiset)
 {
 	bool success=true;
 	multiset.clear();
-	std::string object;
+	ObjectString object;
 	for (int i=0;i<sentence.size();i++) {
 		if (sentence[i].getType()==DISSOLUTION_SYMBOL) {
-			multiset["@d"] = 1;
+			multiset[DISSOLUTION_OBJECT] = 1;
 		} else if (sentence[i].getType()==VARIABLE) {
-			if (!getVariableAsString(sentence[i],object)) {
+			if (!getObject(sentence[i],object)) {
 				success=false;
 			} else {
 				multiset[object]++;
 			}
 		} else if (sentence[i].getType()==MUL) {
-			if (!getVariableAsString(sentence[i][0],object)) {
+			if (!getObject(sentence[i][0],object)) {
 				success=false;
 			}
 			NodeValue multiplicity = computeValue(sentence[i][1]);
@@ -756,7 +1167,7 @@ bool Parser::unrollMultiset(Node& sentence, Multiset& multiset)
 			if (!multiplicity.isValid() || !multiplicity.isLong() || multiplicity.getLong() < 0)  {
 				success=false;
 			} 
-			if (!object.empty() && multiplicity.isValid() && multiplicity.isLong() && multiplicity.getLong() > 0) {
+			if (!object.str().empty() && multiplicity.isValid() && multiplicity.isLong() && multiplicity.getLong() > 0) {
 				multiset[object]+=multiplicity.getLong();
 			}
 		}
@@ -784,26 +1195,32 @@ bool Parser::unrollMultiset(Node& sentence) {
 			success = unrollMultiset(sentence[i],multiset) ? success : false;
 		}
 	}
-	if (success) {
-		if (type == ASIG) {
-			if (verbosityLevel>=LEVEL_DEBUG_1) {
-				std::ostringstream buffer;
-				buffer << "ms("<<label<<") = "<< multiset;
-				error(buffer.str().c_str(),sentence.getLocation(),LEVEL_DEBUG_1);
-			}
-			file.psystem.multisets[label] = multiset;
-		} else {
-			if (verbosityLevel>=LEVEL_DEBUG_1) {
-				std::ostringstream buffer;
-				buffer << "ms("<<label<<") += "<< multiset;
-				error(buffer.str().c_str(),sentence.getLocation(),LEVEL_DEBUG_1);
-			}
-			for (auto it = multiset.begin(); it!= multiset.end(); ++it) {
-				file.psystem.multisets[label][it->first]+=it->second;
-			}
+	return success && addMultiset(sentence,label,multiset,type);
+}
+
+bool Parser::addMultiset(Node& sentence, const Label& label, const Multiset& multiset, int type) {
+	if (unrolling!=NULL && unrolling->worker) {
+		unrolling->multisets.emplace_back(label,multiset,type);
+		return true;
+	}
+	if (type == ASIG) {
+		if (verbosityLevel>=LEVEL_DEBUG_1) {
+			std::ostringstream buffer;
+			buffer << "ms("<<label<<") = "<< multiset;
+			error(buffer.str().c_str(),sentence.getLocation(),LEVEL_DEBUG_1);
 		}
-	}	
-	return success;
+		file.psystem.multisets[label] = multiset;
+	} else {
+		if (verbosityLevel>=LEVEL_DEBUG_1) {
+			std::ostringstream buffer;
+			buffer << "ms("<<label<<") += "<< multiset;
+			error(buffer.str().c_str(),sentence.getLocation(),LEVEL_DEBUG_1);
+		}
+		for (auto it = multiset.begin(); it!= multiset.end(); ++it) {
+			file.psystem.multisets[label][it->first]+=it->second;
+		}
+	}
+	return true;
 }
 
 bool Parser::unrollInnerMembrane(Node& sentence, IMembrane& membrane, const std::string& patternGroup, const Label& defaultLabel, bool flag) {
@@ -993,7 +1410,7 @@ bool Parser::unrollRule(Node& sentence, const std::string& patternGroup) {
 				error("negative priority", sentence[i][0].getLocation());
 			}
 			if (value.isValid() && value.isLong() && value.getLong() >= 0) {
-				if (rule.features.count("priority")>0) {
+				if (rule.features.count(PRIORITY_FEATURE)>0) {
 					error("ignoring duplicated feature 'priority'",sentence[i].getLocation(),LEVEL_WARNING);
 				} else {
 					if (verbosityLevel>=LEVEL_DEBUG_1) {
@@ -1001,7 +1418,7 @@ bool Parser::unrollRule(Node& sentence, const std::string& patternGroup) {
 						buffer << "priority "<<value.getLong();
 						error(buffer.str().c_str(),sentence[i].getLocation(),LEVEL_DEBUG_1);
 					}
-					rule.features["priority"] = value.getLong();
+					rule.features[PRIORITY_FEATURE] = value.getLong();
 				}
 			} else {
 				success = false;
@@ -1027,7 +1444,7 @@ bool Parser::unrollRule(Node& sentence, const std::string& patternGroup) {
 				} 
 			}
 			if (p >= 0.0 && p <= 1.0) {
-				if (rule.features.count("probability")>0) {
+				if (rule.features.count(PROBABILITY_FEATURE)>0) {
 					error("ignoring duplicated feature 'probability'",sentence[i].getLocation(),LEVEL_WARNING);
 				} else {
 					if (verbosityLevel>=LEVEL_DEBUG_1) {
@@ -1035,7 +1452,7 @@ bool Parser::unrollRule(Node& sentence, const std::string& patternGroup) {
 						buffer << "probability "<<p;
 						error(buffer.str().c_str(),sentence[i].getLocation(),LEVEL_DEBUG_1);
 					}
-					rule.features["probability"] = p;
+					rule.features[PROBABILITY_FEATURE] = p;
 					hasProbability = true;
 				}
 			} else {
@@ -1076,36 +1493,65 @@ bool Parser::unrollRule(Node& sentence, const std::string& patternGroup) {
 	}
 		
 	if (success) {
-		if (hasProbability && rule.features["probability"].as_double() == 0.0) {
+		if (hasProbability && rule.features[PROBABILITY_FEATURE].as_double() == 0.0) {
 			return true;
 		}
-		if (file.psystem.rules.count(rule)>0) {
+		if (patternGroup.empty()) {
+			return addRule(sentence,rule);
+		}
+		if (containsRule(rule)) {
 			error("ignoring duplicated rule",sentence.getLocation(),LEVEL_INFO);
 			return true;
 		}
-		if (patternGroup.empty()) {
-			if (verbosityLevel>=LEVEL_DEBUG_1) {
-				std::ostringstream buffer;
-				buffer << "rule "<<rule;
-				error(buffer.str().c_str(),sentence.getLocation(),LEVEL_DEBUG_1);
-			}
-			success = checkRule(rule,sentence.getLocation());
-			if (success) {
-				file.psystem.rules.insert(rule);
-			}
-		} else {
-			if (verbosityLevel>=LEVEL_DEBUG_1) {
-				std::ostringstream buffer;
-				buffer << "pattern("<<patternGroup<<") " << rule;
-				error(buffer.str().c_str(),sentence.getLocation(),LEVEL_DEBUG_1);
-			}
-			patterns[patternGroup].insert(rule);
+		if (verbosityLevel>=LEVEL_DEBUG_1) {
+			std::ostringstream buffer;
+			buffer << "pattern("<<patternGroup<<") " << rule;
+			error(buffer.str().c_str(),sentence.getLocation(),LEVEL_DEBUG_1);
 		}
+		patterns[patternGroup].insert(rule);
+		patternCache.clear();
 		return success;
 	}
 	return false;
 }
 
+bool Parser::addRule(Node& sentence, Rule& rule) {
+	// workers check the rule against the patterns, duplicates are found when the buffers are merged
+	if (unrolling!=NULL && unrolling->worker) {
+		if (!checkRule(rule,sentence.getLocation())) {
+			return false;
+		}
+		unrolling->rules.push_back(std::move(rule));
+		return true;
+	}
+	if (containsRule(rule)) {
+		error("ignoring duplicated rule",sentence.getLocation(),LEVEL_INFO);
+		return true;
+	}
+	if (verbosityLevel>=LEVEL_DEBUG_1) {
+		std::ostringstream buffer;
+		buffer << "rule "<<rule;
+		error(buffer.str().c_str(),sentence.getLocation(),LEVEL_DEBUG_1);
+	}
+	bool success = checkRule(rule,sentence.getLocation());
+	if (success) {
+		insertRule(rule);
+	}
+	return success;
+}
+
+bool Parser::containsRule(const Rule& rule) const {
+	return streaming ? spool.count(rule)>0 : file.psystem.rules.count(rule)>0;
+}
+
+void Parser::insertRule(const Rule& rule) {
+	if (streaming) {
+		spool.insert(rule);
+	} else {
+		file.psystem.rules.insert(rule);
+	}
+}
+
 bool Parser::unrollSentences(Node& sentence) {
 	bool success = true;
 	for (int i=0;i<sentence.size() && !memory.containsLocalVariable(RETURN_VARIABLE);i++) {
@@ -1245,6 +1691,27 @@ const NodeValue& Parser::computeValue(Node& node)
 		return node.getValue();
 	}
 	NodeValue v;
+	if (unrolling!=NULL && unrolling->worker) {
+		// workers cannot write the syntax tree, the tree walker reports the errors later
+		if (node.getBytecode()==NULL) {
+			unrolling->failed = true;
+			return UNKNOWN_VALUE;
+		}
+		NodeValue& value = unrolling->values[node.getBytecode()->getIndex()];
+		if (!node.getBytecode()->evaluate(memory,unrolling->slots.data(),value)) {
+			unrolling->failed = true;
+			value = UNKNOWN_VALUE;
+		}
+		return value;
+	}
+	if (unrolling!=NULL && node.getBytecode()!=NULL) {
+		if (node.getBytecode()->evaluate(memory,unrolling->slots.data(),v)) {
+			node.setValue(v);
+			return node.getValue();
+		}
+		// the tree walker reports the errors, it reads the range variables from memory
+		storeSlots();
+	}
 	switch(node.getType()) {
 		case VARIABLE:
 			node.setValue(getVariable(node));
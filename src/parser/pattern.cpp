@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <parser/parser.hpp>
 
 using namespace plingua::parser;
@@ -7,25 +8,87 @@ using namespace plingua::parser;
 
 
 bool Parser::checkRule(Rule& rule,  const YYLTYPE& location) {
-	bool success = false;
-	if (rule.features.count("pattern")>0) {
+	if (rule.features.count(PATTERN_FEATURE)>0) {
 		return true;
 	}
-	for (auto it = patterns.begin(); it != patterns.end() && !success; ++it) {
-		const std::string& id = it->first;
-		const std::set<Rule>& rules = it->second;
-		for (auto it1 = rules.begin(); it1!= rules.end() && !success; ++it1) {
-			const Rule& pattern = *it1;
-			if(matchRule(rule, pattern)) {
-				rule.features["pattern"] = id;
-				success = true;
-			}
+	for (const CandidatePattern& candidate : getCandidatePatterns(rule)) {
+		if(matchRule(rule, *candidate.second)) {
+			rule.features[PATTERN_FEATURE] = *candidate.first;
+			return true;
+		}
+	}
+	error("invalid rule",location);
+	return false;
+}
+
+// class of a multiset in the shape of a rule
+static int getMultisetClass(const plingua::Multiset& multiset) {
+	return multiset.empty() ? 0 : multiset.size()==1 && multiset.begin()->second.raw()==1 ? 1 : 2;
+}
+
+void Parser::getShape(const Rule& rule, Shape& shape) {
+	shape.clear();
+	shape.push_back(rule.arrow);
+	shape.push_back(rule.lhr.membrane.label.size());
+	shape.push_back(rule.lhr.membrane.data.size());
+	shape.push_back(rule.lhr.membrane.charge);
+	shape.push_back(getMultisetClass(rule.lhr.multiset));
+	shape.push_back(getMultisetClass(rule.lhr.membrane.multiset));
+	shape.push_back(getMultisetClass(rule.rhr.multiset));
+	shape.push_back(rule.rhr.data.size());
+	// the right-hand membranes are matched in any order
+	unsigned first = shape.size();
+	for (const OMembrane& membrane : rule.rhr.data) {
+		shape.push_back(membrane.data.size());
+	}
+	std::sort(shape.begin()+first,shape.end());
+}
+
+bool Parser::matchShape(const Shape& shape, const Rule& pattern) {
+	auto matchClass = [](int multisetClass, const Multiset& multiset) {
+		return isMultisetPattern(multiset) || (isSingleObjectPattern(multiset) ? multisetClass==1 : multisetClass==getMultisetClass(multiset));
+	};
+	if (shape[0]!=pattern.arrow || shape[1]!=(int)pattern.lhr.membrane.label.size() || shape[2]!=(int)pattern.lhr.membrane.data.size() ||
+		(pattern.lhr.membrane.charge<2 && shape[3]!=pattern.lhr.membrane.charge) ||
+		!matchClass(shape[4],pattern.lhr.multiset) || !matchClass(shape[5],pattern.lhr.membrane.multiset) || !matchClass(shape[6],pattern.rhr.multiset) ||
+		shape[7]!=(int)pattern.rhr.data.size()) {
+		return false;
+	}
+	std::vector<int> inner;
+	for (const OMembrane& membrane : pattern.rhr.data) {
+		inner.push_back(membrane.data.size());
+	}
+	std::sort(inner.begin(),inner.end());
+	return std::equal(inner.begin(),inner.end(),shape.begin()+8);
+}
+
+const std::vector<Parser::CandidatePattern>& Parser::getCandidatePatterns(const Rule& rule) {
+	// the patterns which can match a shape keep the order of the groups, so the first match does not change;
+	// workers share the cache, its vectors are never modified once they are added
+	Shape shape;
+	getShape(rule,shape);
+	{
+		SharedLock lock(patternMutex);
+		auto it = patternCache.find(shape);
+		if (it != patternCache.end()) {
+			return it->second;
 		}
 	}
-	if (!success) {
-		error("invalid rule",location);
+	std::lock_guard<SharedMutex> lock(patternMutex);
+	auto it = patternCache.find(shape);
+	if (it != patternCache.end()) {
+		// added by another worker meanwhile
+		return it->second;
+	}
+	std::vector<CandidatePattern>& candidates = patternCache[shape];
+	for (auto it = patterns.begin(); it != patterns.end(); ++it) {
+		for (const Rule& pattern : it->second) {
+			if (matchShape(shape,pattern)) {
+				candidates.emplace_back(&it->first,&pattern);
+			}
+		}
 	}
-	return success;
+	return candidates;
 }
 
 bool Parser::matchRule(const Rule& rule, const Rule& pattern) {
@@ -100,7 +163,10 @@ bool Parser::matchOMembranes(const RHR& rRHR, const RHR& pRHR, Match& match, uns
 	for (unsigned i = index; i< permutation.size(); i++) {
 		permutation[index] = permutation[i];
 		permutation[i] = aux;
-		if (matchOMembranes(rRHR,pRHR,match,index+1,permutation)) {
+		const OMembrane& rM = rRHR.data[permutation[index]];
+		const OMembrane& pM = pRHR.data[index];
+		if (rM.data.size()==pM.data.size() && rM.label.size()==pM.label.size() && (pM.charge>=2 || rM.charge==pM.charge) &&
+			matchOMembranes(rRHR,pRHR,match,index+1,permutation)) {
 			return true;
 		}
 		permutation[i] = permutation[index];
@@ -126,7 +192,10 @@ bool Parser::matchIMembranes(const OMembrane& rM, const OMembrane& pM, Match& ma
 	for (unsigned i = index; i< permutation.size(); i++) {
 		permutation[index] = permutation[i];
 		permutation[i] = aux;
-		if (matchIMembranes(rM,pM,match,index+1,permutation)) {
+		const IMembrane& rI = rM.data[permutation[index]];
+		const IMembrane& pI = pM.data[index];
+		if (rI.label.size()==pI.label.size() && (pI.charge>=2 || rI.charge==pI.charge) &&
+			matchIMembranes(rM,pM,match,index+1,permutation)) {
 			return true;
 		}
 		permutation[i] = permutation[index];
@@ -0,0 +1,8 @@
+#include <parser/parser.hpp>
+
+using namespace plingua::parser;
+
+
+int main(int argc, char* argv[]) {
+	return PARSER.parse(argc,argv);
+}
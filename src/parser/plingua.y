@@ -185,7 +185,7 @@ include : INCLUDE STRING {$$ = new Node(INCLUDE,$2); $$->setLoc(@1,@2);}
 		;
 
 id : ID {$$ = new Node(ID,$1); $$->setLoc(@1);} 
-   | RELEVANCE_REALIZATION {$$ = new Node(ID,strdup("relevance_realization")); $$->setLoc(@1);}
+   | RELEVANCE_REALIZATION {$$ = new Node(ID,PARSER.getArena().copy("relevance_realization")); $$->setLoc(@1);}
    ;
       
 variable : id {$$ = new Node(VARIABLE,$1); $$->setLoc($1);}
@@ -664,11 +664,3 @@ mathematical_space : LAMBDA_CAPITAL expr
 
 			 
 %%
-
-
-int main(int argc, char* argv[]) {
-	return PARSER.parse(argc,argv);
-}
-
-
-
@@ -4,6 +4,8 @@
 #include "y.tab.h"
 using namespace plingua::parser;
 
+const unsigned Memory::NO_SLOT;
+
 
 const NodeValue& Scope::setVariable(const std::string& variable, const NodeValue& value)
 {
@@ -46,24 +48,22 @@ void Scope::print(FILE* fp, const std::string& prefix) const
 
 const NodeValue& Memory::setVariable(const std::string& variable, const NodeValue& value, const YYLTYPE& loc) 
 {
-	if (counter>0) {
-		const NodeValue& v1 = localScope.getVariable(variable);
-		if (v1.isValid()) {
-			if (PARSER.getVerbosityLevel()>=LEVEL_DEBUG_1) {
-				std::string buffer = "set variable '";
-				buffer += variable;
-				buffer +="' = ";
-				buffer += value.castString().getString();
-				buffer += " in local scope ";
-				buffer += std::to_string(counter);
-				PARSER.error(buffer.c_str(),loc,LEVEL_DEBUG_1);
-			}
-			const NodeValue& v = localScope.setVariable(variable,value);
-			if (PARSER.getVerbosityLevel()>=LEVEL_DEBUG_2) {
-				printMemory(stdout);
-			}
-			return v;
+	unsigned counter = getCounter();
+	if (counter>0 && getLocalSlot(variable)!=NO_SLOT) {
+		if (PARSER.getVerbosityLevel()>=LEVEL_DEBUG_1) {
+			std::string buffer = "set variable '";
+			buffer += variable;
+			buffer +="' = ";
+			buffer += value.castString().getString();
+			buffer += " in local scope ";
+			buffer += std::to_string(counter);
+			PARSER.error(buffer.c_str(),loc,LEVEL_DEBUG_1);
+		}
+		const NodeValue& v = setLocalVariable(variable,value);
+		if (PARSER.getVerbosityLevel()>=LEVEL_DEBUG_2) {
+			printMemory(stdout);
 		}
+		return v;
 	}
 	const NodeValue& v2 = globalScope.getVariable(variable);
 	if (v2.isValid()) {
@@ -81,7 +81,6 @@ const NodeValue& Memory::setVariable(const std::string& variable, const NodeValu
 		}
 		return v;
 	}
-	Scope& scope = counter==0 ? globalScope : localScope;
 	if (PARSER.getVerbosityLevel()>=LEVEL_DEBUG_1) {
 		std::string buffer = "set variable '";
 		buffer += variable;
@@ -91,7 +90,7 @@ const NodeValue& Memory::setVariable(const std::string& variable, const NodeValu
 		buffer += std::to_string(counter);
 		PARSER.error(buffer.c_str(),loc,LEVEL_DEBUG_1);
 	}
-	const NodeValue& v = scope.setVariable(variable,value);
+	const NodeValue& v = counter==0 ? globalScope.setVariable(variable,value) : setLocalVariable(variable,value);
 	if (PARSER.getVerbosityLevel()>=LEVEL_DEBUG_2) {
 		printMemory(stdout);
 	}
@@ -102,20 +101,19 @@ const NodeValue& Memory::setVariable(const std::string& variable, const NodeValu
 
 const NodeValue& Memory::getVariable(const std::string& variable, const YYLTYPE& loc) const
 {
-	if (counter>0) {
-		const NodeValue& v1 = localScope.getVariable(variable);
-		if (v1.isValid()) {
-			if (PARSER.getVerbosityLevel()>=LEVEL_DEBUG_1) {
-				std::string buffer = "get variable '";
-				buffer += variable;
-				buffer +="' = ";
-				buffer += v1.castString().getString();
-				buffer += " from local scope ";
-				buffer += std::to_string(counter);
-				PARSER.error(buffer.c_str(),loc,LEVEL_DEBUG_1);
-			}
-			return v1;
-		}	
+	unsigned slot = getLocalSlot(variable);
+	if (slot!=NO_SLOT) {
+		const NodeValue& v1 = slots[slot].value;
+		if (PARSER.getVerbosityLevel()>=LEVEL_DEBUG_1) {
+			std::string buffer = "get variable '";
+			buffer += variable;
+			buffer +="' = ";
+			buffer += v1.castString().getString();
+			buffer += " from local scope ";
+			buffer += std::to_string(getCounter());
+			PARSER.error(buffer.c_str(),loc,LEVEL_DEBUG_1);
+		}
+		return v1;
 	}
 	const NodeValue& v2 = globalScope.getVariable(variable);
 	if (v2.isValid()) {
@@ -132,69 +130,88 @@ const NodeValue& Memory::getVariable(const std::string& variable, const YYLTYPE&
 	return getSystemConstant(variable,loc);
 }
 
-void Memory::printMemory(FILE* fp) const
+unsigned Memory::getLocalSlot(const std::string& variable) const
 {
-	fprintf(fp,"STACK SIZE: %lu\n",stack.size());
-	globalScope.print(fp, "global ");
-	if (counter>0) {
-		localScope.print(fp, "local ");
+	if (frames.empty()) {
+		return NO_SLOT;
 	}
+	auto it = names.find(variable);
+	// the slots below the frame belong to the callers
+	if (it==names.end() || it->second==NO_SLOT || it->second<frames.back()) {
+		return NO_SLOT;
+	}
+	return it->second;
 }
 
-void Scope::clear() {
-	scope.clear();
-}
-
-
-void Scope::saveToStack(Stack& stack)
+const NodeValue& Memory::setLocalVariable(const std::string& variable, const NodeValue& value)
 {
-	for (auto it = scope.begin(); it!= scope.end(); ++it) {
-		stack.push(it->first,it->second);
+	if (variable.empty()) {
+		return INVALID_LVALUE_ERROR;
 	}
-	stack.push("size",NodeValue((long)scope.size()));
+	if (!value.isValid()) {
+		return INVALID_RVALUE_ERROR;
+	}
+	auto it = names.find(variable);
+	if (it==names.end()) {
+		it = names.emplace(variable,NO_SLOT).first;
+	} else if (it->second!=NO_SLOT && it->second>=frames.back()) {
+		NodeValue& m = slots[it->second].value;
+		m.set(value,false);
+		return m;
+	}
+	if (top==slots.size()) {
+		slots.emplace_back();
+	}
+	Slot& slot = slots[top];
+	slot.name = &*it;
+	slot.hidden = it->second;
+	slot.value.set(value,false);
+	it->second = top++;
+	return slot.value;
 }
 
-void Memory::clear()
+void Memory::printMemory(FILE* fp) const
 {
-	localScope.clear();
-	globalScope.clear();
-	while(!stack.empty()) {
-		stack.pop();
+	fprintf(fp,"STACK SIZE: %u\n",top);
+	globalScope.print(fp, "global ");
+	if (!frames.empty()) {
+		for (unsigned i=frames.back();i<top;i++) {
+			fprintf(fp,"local %s = ",slots[i].name->first.c_str());
+			slots[i].value.print(fp);
+			fprintf(fp,"\n");
+		}
 	}
-	counter = 0;
 }
 
-void Scope::loadFromStack(Stack& stack) {
-	long size = stack.topB().getLong();
-	stack.pop();
-	while(size > 0) {
-		scope.emplace(std::piecewise_construct,
-						std::forward_as_tuple(stack.topA()),
-						std::forward_as_tuple(stack.topB()));
-		stack.pop();
-		--size;
-	}
+void Scope::clear() {
+	scope.clear();
 }
 
+void Memory::clear()
+{
+	globalScope.clear();
+	names.clear();
+	slots.clear();
+	top = 0;
+	frames.clear();
+}
 
 void Memory::pushScope()
 {
-	if (++counter == 1) {
-		return;
-	}
-	localScope.saveToStack(stack);
-	localScope.clear();
+	frames.push_back(top);
 }
 
 
 void Memory::popScope()
 {
-	if (counter==0) {
+	if (frames.empty()) {
 		return;
 	}
-	--counter;
-	localScope.clear();
-	if (counter>0) {
-		localScope.loadFromStack(stack);
+	// the names of the frame get back their hidden slots, the slots are kept to be reused
+	while (top>frames.back()) {
+		Slot& slot = slots[--top];
+		slot.name->second = slot.hidden;
+		slot.value.clear();
 	}
+	frames.pop_back();
 }
@@ -1,7 +1,9 @@
 #include <string>
 #include <cstdio>
+#include <algorithm>
 #include <parser/parser.hpp>
 #include <parser/syntax_tree.hpp>
+#include <parser/bytecode.hpp>
 #include "y.tab.h"
 
 using namespace plingua::parser;
@@ -45,19 +47,48 @@ int YYLTYPE::print(FILE *fp) const
 
 Node::~Node() 
 {
-	clear();
+	setBytecode(NULL);
 }
 
-void Node::clear()
+void* Node::operator new(std::size_t size)
+{
+	Arena& arena = PARSER.getArena();
+	Node* node = static_cast<Node*>(arena.allocate(size));
+	arena.addDestructor(node);
+	return node;
+}
+
+Node* Node::addChild(Node* child)
 {
-	for (unsigned i=0;i<childs.size();i++) {
-		delete childs[i];
+	if (child==NULL) {
+		return this;
 	}
-	childs.clear();
+	if (count == capacity) {
+		// the old array is left in the arena
+		capacity = capacity == 0 ? 2 : 2 * capacity;
+		Node** aux = static_cast<Node**>(PARSER.getArena().allocate(capacity * sizeof(Node*)));
+		std::copy(childs, childs + count, aux);
+		childs = aux;
+	}
+	childs[count++] = child;
+	return this;
+}
+
+void Node::clear()
+{
+	childs = NULL;
+	count = 0;
+	capacity = 0;
 	value.clear(); 
 	loc.clear();
 	type = 0;
-	
+	setBytecode(NULL);
+}
+
+void Node::setBytecode(Bytecode* bytecode)
+{
+	delete Node::bytecode;
+	Node::bytecode = bytecode;
 }
 
 
@@ -112,10 +143,10 @@ bool Node::isExpression() const
 
 void Node::removeChild(int index)
 {
-	for (unsigned i=index+1; i< childs.size(); i++) {
+	for (int i=index+1; i< count; i++) {
 		childs[i-1] = childs[i];
 	}
-	childs.pop_back();
+	count--;
 }
 
 const char* Node::getTypeAsString() const
@@ -1,7 +1,9 @@
 #include <iostream>
 #include <exception>
+#include <algorithm>
 #include <boost/program_options.hpp>
 #include <simulator/command_line.hpp>
+#include <trace.hpp>
 #include <gpl.hpp>
 
 
@@ -10,18 +12,46 @@ using namespace plingua::simulator;
 
 CommandLine::CommandLine()
 : randomized(false),
+  pruning(false),
+  macroStepping(false),
+  binomialSelection(false),
+  profilingSteps(false),
+  timingRules(false),
   verbosityLevel(0),
   steps(0),
+  residentMembranes(0),
+  traceEvents(Tracer::DEFAULT_CAPACITY),
+  memorySteps(0),
+  seeded(false),
+  seed(0),
   outputFile("a.json") {}
 
 bool CommandLine::parse(int argc, char *argv[])
 {
 	
 	randomized = false;
+	pruning = false;
+	macroStepping = false;
+	binomialSelection = false;
+	profilingSteps = false;
+	timingRules = false;
 	verbosityLevel = 0;
 	steps = 0;
+	residentMembranes = 0;
+	traceEvents = Tracer::DEFAULT_CAPACITY;
+	memorySteps = 0;
+	seeded = false;
+	seed = 0;
+	pageFile = "";
+	statsFile = "";
+	profileFile = "";
+	ruleProfileFile = "";
+	traceFile = "";
+	memoryFile = "";
+	liveViewName = "";
 	bool ready = false;
 	inputFile = "";
+	includePaths.clear();
 	outputFile = "a.json";
 	configurationFile = "";
 	
@@ -34,10 +64,27 @@ bool CommandLine::parse(int argc, char *argv[])
 	("license,l", "show the GPLv3 license")
 	("verbosity,v", po::value<int>(), "set the verbosity level")
 	("randomized,r", "set randomized feature")
+	("seed", po::value<unsigned>(), "set the seed of the random number generator, to reproduce randomized simulations")
+	("binomial,b", "in randomized mode, share the objects among competing rules with binomial draws instead of uniform ones")
 	("steps,s", po::value<int>(), "set the number of steps to simulate")
 	("configuration,c", po::value<string>(),"set the initial configuration file")
+	("prune,p", "remove rules that can never be applied before simulating")
+	("macro-steps,m", "apply stretches of identical deterministic steps at once")
 	("output,o", po::value<string>(),"set the output file")
-	("psystem", po::value< string>(), "set the psystem file")
+	("resident,R", po::value<int>(), "set the maximum number of membrane multisets kept in memory, the coldest ones are paged to a file (0 for no limit)")
+	("page-file,F", po::value<string>(), "set the file used for paging membranes (a temporary file by default)")
+	("stats,S", po::value<string>(), "write the statistics of the simulation (steps, rule applications, time and peak memory) as JSON to a file")
+	("profile,P", po::value<string>(), "measure the time of every simulation phase and count passes and rules, and write them as JSON to a file at the end")
+	("profile-steps", "write the profile of every step instead, one JSON object per line")
+	("rule-profile", po::value<string>(), "count the evaluations and applications of every rule, and write them ranked to a file at the end")
+	("rule-profile-time", "measure the time spent computing the applications of every rule in the rule profile")
+	("trace", po::value<string>(), "write a Chrome/Perfetto trace of the loading and of the phases of every step to a file")
+	("trace-events", po::value<unsigned>(), "set the maximum number of trace events kept, the latest ones are written")
+	("memory", po::value<string>(), "write the approximate memory used by configurations, rules and alphabets to a file at the end")
+	("memory-steps", po::value<unsigned>(), "write the memory report every given number of steps too")
+	("live", po::value<string>(), "publish counters and object counts of every step to a POSIX shared memory segment with the given name, see pview")
+	("include,I", po::value< vector<string> >(), "set a path for including files when the psystem is a .pli file")
+	("psystem", po::value< string>(), "set the psystem file, .pli files are compiled before simulating")
 	;
 	
 	po::positional_options_description p;
@@ -54,7 +101,8 @@ bool CommandLine::parse(int argc, char *argv[])
 		std::cout << "Example:"<<std::endl;
 		std::cout << "  "<<argv[0]<<" psystem.json -c init_configuration.json -s 100 -o output.json -v 5" << std::endl << std::endl;
 		std::cout << "Note:"<<std::endl;
-		std::cout << "  input/output files can be .json, .xml, .bin or .bin2; see P-Lingua help for more information"<<std::endl << std::endl;
+		std::cout << "  input/output files can be .json, .xml, .bin or .bin2; see P-Lingua help for more information"<<std::endl;
+		std::cout << "  the psystem can be a .pli file too, it is compiled in the process as plingua does"<<std::endl << std::endl;
 	} else if (vm.count("about")) {
 		printAbout();
 	} else if (vm.count("license")) {
@@ -63,6 +111,19 @@ bool CommandLine::parse(int argc, char *argv[])
 		if (vm.count("randomized")) {
 			randomized = true;
 		}
+		if (vm.count("seed")) {
+			seeded = true;
+			seed = vm["seed"].as<unsigned>();
+		}
+		if (vm.count("binomial")) {
+			binomialSelection = true;
+		}
+		if (vm.count("prune")) {
+			pruning = true;
+		}
+		if (vm.count("macro-steps")) {
+			macroStepping = true;
+		}
 		
 		if (vm.count("verbosity")) {
 			verbosityLevel = vm["verbosity"].as<int>();
@@ -73,10 +134,52 @@ bool CommandLine::parse(int argc, char *argv[])
 		if (vm.count("output")) {
 			outputFile = vm["output"].as<string>();
 		}
+		if (vm.count("resident")) {
+			residentMembranes = std::max(0,vm["resident"].as<int>());
+		}
+		if (vm.count("page-file")) {
+			pageFile = vm["page-file"].as<string>();
+		}
+		if (vm.count("stats")) {
+			statsFile = vm["stats"].as<string>();
+		}
+		if (vm.count("profile")) {
+			profileFile = vm["profile"].as<string>();
+		}
+		if (vm.count("profile-steps")) {
+			profilingSteps = true;
+		}
+		if (vm.count("rule-profile")) {
+			ruleProfileFile = vm["rule-profile"].as<string>();
+		}
+		if (vm.count("rule-profile-time")) {
+			timingRules = true;
+		}
+		if (vm.count("trace")) {
+			traceFile = vm["trace"].as<string>();
+		}
+		if (vm.count("trace-events")) {
+			traceEvents = vm["trace-events"].as<unsigned>();
+		}
+		if (vm.count("memory")) {
+			memoryFile = vm["memory"].as<string>();
+		}
+		if (vm.count("memory-steps")) {
+			memorySteps = vm["memory-steps"].as<unsigned>();
+		}
+		if (vm.count("live")) {
+			liveViewName = vm["live"].as<string>();
+			if (liveViewName.empty() || liveViewName[0] != '/') {
+				liveViewName = "/" + liveViewName;
+			}
+		}
 	
 		if (vm.count("configuration")) {
 			configurationFile = vm["configuration"].as<string>();
 		} 
+		if (vm.count("include")) {
+			includePaths = vm["include"].as< vector<string> >();
+		}
 		if (vm.count("psystem")) {
 			inputFile = vm["psystem"].as<string>();
 		} else {
@@ -0,0 +1,84 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <signal.h>
+#include <boost/program_options.hpp>
+
+#include <simulator/live_view.hpp>
+
+// Reader of the live view published by psim --live
+
+using namespace plingua::simulator;
+namespace po = boost::program_options;
+
+void print(const LiveSnapshot& snapshot, unsigned top)
+{
+	std::cout << "TIME: " << snapshot.time << (snapshot.finished ? " (halted)" : "") << std::endl;
+	std::cout << "\tseconds: " << std::fixed << std::setprecision(3) << snapshot.seconds << std::endl;
+	std::cout << "\tmembranes: " << snapshot.membranes << " (" << snapshot.activeMembranes << " active, " << snapshot.pagedMembranes << " paged)" << std::endl;
+	std::cout << "\tapplications: " << snapshot.applications << std::endl;
+	std::cout << "\tobjects: " << snapshot.totalObjects << std::endl;
+	std::vector<unsigned> order;
+	for (unsigned i = 0; i < snapshot.objects; i++) {
+		if (snapshot.counts[i] > 0) {
+			order.push_back(i);
+		}
+	}
+	std::stable_sort(order.begin(), order.end(), [&snapshot](unsigned a, unsigned b) {return snapshot.counts[a] > snapshot.counts[b];});
+	if (top > 0 && order.size() > top) {
+		order.resize(top);
+	}
+	for (unsigned i : order) {
+		std::cout << "\t\t" << std::string(snapshot.names[i], strnlen(snapshot.names[i], LiveSnapshot::NAME_SIZE)) << "*" << snapshot.counts[i] << std::endl;
+	}
+	if (snapshot.untracked > 0) {
+		std::cout << "\t\t(" << snapshot.untracked << " objects not tracked)" << std::endl;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	po::options_description desc("Options");
+	desc.add_options()
+	("help,h", "show this help")
+	("watch,w", po::value<double>(), "print the view again every given number of seconds until psim halts")
+	("top,t", po::value<unsigned>()->default_value(20), "number of objects to print, 0 for all of them")
+	("name", po::value<std::string>()->default_value("/psim"), "name of the shared memory segment given to psim --live");
+	po::positional_options_description positional;
+	positional.add("name", 1);
+	try {
+		po::variables_map vm;
+		po::store(po::command_line_parser(argc, argv).options(desc).positional(positional).run(), vm);
+		po::notify(vm);
+		if (vm.count("help")) {
+			std::cout << "usage: " << argv[0] << " [options] [name]" << std::endl << desc << std::endl;
+			return 0;
+		}
+		std::string name = vm["name"].as<std::string>();
+		if (name.empty() || name[0] != '/') {
+			name = "/" + name;
+		}
+		LiveViewReader reader;
+		reader.open(name);
+		LiveSnapshot snapshot;
+		do {
+			if (!reader.read(snapshot)) {
+				throw std::runtime_error("the live view is busy");
+			}
+			print(snapshot, vm["top"].as<unsigned>());
+			if (vm.count("watch") && !snapshot.finished && kill(snapshot.pid, 0) != 0) {
+				std::cout << "psim is not running" << std::endl;
+				break;
+			}
+			if (vm.count("watch") && !snapshot.finished) {
+				usleep(vm["watch"].as<double>() * 1000000);
+			}
+		} while (vm.count("watch") && !snapshot.finished);
+	} catch (std::exception& ex) {
+		std::cout << ex.what() << std::endl;
+		std::cout << "type '" << argv[0] << " --help' for help" << std::endl;
+		return 1;
+	}
+	return 0;
+}